@@ -51,7 +51,7 @@ gcc{
 
 
 # common config
-QT += core gui widgets xml opengl network printsupport svg
+QT += core gui widgets xml opengl network printsupport svg concurrent
 CONFIG += c++14
 
 
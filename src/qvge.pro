@@ -20,6 +20,9 @@ qsint.file = $$PWD/3rdParty/qsint-widgets/qsint-widgets.pro
 SUBDIRS += qvgeio
 qvgeio.file = $$PWD/qvgeio/qvgeio.pro
 
+SUBDIRS += qvgeiobench
+qvgeiobench.file = $$PWD/qvgeiobench/qvgeiobench.pro
+
 SUBDIRS += qvgelib
 qvgelib.file = $$PWD/qvgelib/qvgelib.pro
 
@@ -13,12 +13,56 @@ It can be used freely, maintaining the information above.
 #include <QDebug>
 #include <QTextStream>
 #include <QFont>
+#include <QHash>
+#include <QVector>
+
+#include <cstdio>
+#include <limits>
 
 #ifdef USE_BOOST
     #include <boost/graph/adjacency_list.hpp>
     #include <boost/graph/graphviz.hpp>
 #endif
 
+
+// helpers
+
+static QString fromDotShape(const QString& shape)
+{
+	// rename to conform dot
+	if (shape == "ellipse")		return "disc";
+	if (shape == "rect" || shape == "box" ) return "square";
+	if (shape == "invtriangle")	return "triangle2";
+
+	// else take original
+	return shape;
+}
+
+
+static void fromDotFontName(const QString& fontname, QFont& f)
+{
+	QString fontstring = fontname.toLower();
+
+	if (fontstring.contains("bold"))
+	{
+		fontstring = fontstring.remove("bold");
+		f.setBold(true);
+	}
+
+	if (fontstring.contains("italic"))
+	{
+		fontstring = fontstring.remove("italic");
+		f.setItalic(true);
+	}
+
+	f.setFamily(fontstring);
+}
+
+
+// Boost::Graph reader (kept for comparison)
+
+#ifdef USE_BOOST
+
 struct DotVertex
 {
 	std::string id;
@@ -45,7 +89,7 @@ struct DotEdge
 {
 	std::string id;
 	std::string dir;
-	
+
 	std::string color;
 	std::string style;
 	float penwidth = .0;
@@ -59,23 +103,7 @@ struct DotEdge
 	float fontsize = .0;
 };
 
-#ifdef USE_BOOST
-    typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::directedS, DotVertex, DotEdge> graph_t;
-#endif
-
-
-// helpers
-
-static QString fromDotShape(const std::string& shape)
-{
-	// rename to conform dot
-	if (shape == "ellipse")		return "disc";
-	if (shape == "rect" || shape == "box" ) return "square";
-	if (shape == "invtriangle")	return "triangle2";
-
-	// else take original
-	return QString::fromStdString(shape);
-}
+typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::directedS, DotVertex, DotEdge> graph_t;
 
 
 template<class DotLabel>
@@ -94,23 +122,7 @@ static void readLabel(const DotLabel &v, GraphAttributes &attrs)
 	{
 		QFont f;
 		if (v.fontname.size())
-		{
-			QString fontstring = QString::fromStdString(v.fontname).toLower();
-			
-			if (fontstring.contains("bold"))
-			{
-				fontstring = fontstring.remove("bold");
-				f.setBold(true);
-			}
-			
-			if (fontstring.contains("italic"))
-			{
-				fontstring = fontstring.remove("italic");
-				f.setItalic(true);
-			}
-
-			f.setFamily(fontstring);
-		}
+			fromDotFontName(QString::fromStdString(v.fontname), f);
 
 		if (v.fontsize > .0)
 			f.setPointSizeF(v.fontsize);
@@ -120,11 +132,8 @@ static void readLabel(const DotLabel &v, GraphAttributes &attrs)
 }
 
 
-// reimp
-
-bool CFormatDOT::load(const QString& fileName, Graph& g, QString* lastError) const
+static bool loadViaBoost(const QString& fileName, Graph& g, QString* lastError)
 {
-#ifdef USE_BOOST
 	graph_t graphviz;
 	boost::dynamic_properties dp(boost::ignore_other_properties);
 
@@ -165,20 +174,23 @@ bool CFormatDOT::load(const QString& fileName, Graph& g, QString* lastError) con
 
 		if (!status)
 		{
-			*lastError = ("Failed reading DOT format");
+			if (lastError)
+				*lastError = ("Failed reading DOT format");
 			return false;
 		}
 	}
 
 	catch (boost::bad_graphviz_syntax e)
 	{
-		*lastError = QString::fromStdString(e.what());
+		if (lastError)
+			*lastError = QString::fromStdString(e.what());
 		return false;
 	}
 
 	catch (...)
 	{
-		*lastError = ("BGL: unknown exception");
+		if (lastError)
+			*lastError = ("BGL: unknown exception");
 		return false;
 	}
 
@@ -198,7 +210,7 @@ bool CFormatDOT::load(const QString& fileName, Graph& g, QString* lastError) con
 
 		if (v.fillcolor.size())
 			n.attrs["color"] = QColor(QString::fromStdString(v.fillcolor));
-		
+
 		if (v.width > .0)
 			n.attrs["width"] = v.width * 72.0;
 
@@ -214,7 +226,7 @@ bool CFormatDOT::load(const QString& fileName, Graph& g, QString* lastError) con
 		}
 
 		if (v.shape.size())
-			n.attrs["shape"] = fromDotShape(v.shape);
+			n.attrs["shape"] = fromDotShape(QString::fromStdString(v.shape));
 
 		if (v.color.size())
 			n.attrs["stroke.color"] = QColor(QString::fromStdString(v.color));
@@ -241,7 +253,7 @@ bool CFormatDOT::load(const QString& fileName, Graph& g, QString* lastError) con
 
 			Q_ASSERT(i >= 0 && i < nodesCount);
 			Q_ASSERT(gvtarget >= 0 && gvtarget < nodesCount);
-			
+
 			Edge e;
 			e.startNodeId = g.nodes.at(i).id;
 			e.endNodeId = g.nodes.at(gvtarget).id;
@@ -267,15 +279,882 @@ bool CFormatDOT::load(const QString& fileName, Graph& g, QString* lastError) con
 
 	// done
     return status;
+}
+
+#endif // USE_BOOST
+
+
+// Native reader: tokens are pointing into the (mapped) file data, no copying until stored into the Graph
+
+struct DotToken
+{
+	enum Type
+	{
+		End, Error,
+		Id, Quoted, Html,
+		LBrace, RBrace, LBracket, RBracket,
+		Semicolon, Comma, Colon, Equal, EdgeOp
+	};
+
+	Type type = End;
+	const char *ptr = nullptr;
+	int len = 0;
+	bool escaped = false;	// quoted string contains backslashes or "a" + "b" concatenation
+
+	bool isId() const { return type == Id || type == Quoted || type == Html; }
+
+	bool isKeyword(const char *word) const
+	{
+		// keywords are case independent
+		return type == Id && uint(len) == qstrlen(word) && qstrnicmp(ptr, word, len) == 0;
+	}
+};
+
+
+class DotTokenizer
+{
+public:
+	DotTokenizer(const char *data, int size): m_pos(data), m_end(data + size)
+	{
+		// skip UTF-8 BOM
+		if (size >= 3 && uchar(data[0]) == 0xEF && uchar(data[1]) == 0xBB && uchar(data[2]) == 0xBF)
+			m_pos += 3;
+	}
+
+	int line() const { return m_line; }
+
+	const DotToken& peek()
+	{
+		if (!m_hasPeeked)
+		{
+			m_peeked = read();
+			m_hasPeeked = true;
+		}
+
+		return m_peeked;
+	}
+
+	DotToken next()
+	{
+		if (m_hasPeeked)
+		{
+			m_hasPeeked = false;
+			return m_peeked;
+		}
+
+		return read();
+	}
+
+private:
+	static bool isIdChar(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '.' || uchar(c) >= 0x80;
+	}
+
+	void skipSpaces()
+	{
+		while (m_pos < m_end)
+		{
+			char c = *m_pos;
+
+			if (c == '\n')
+			{
+				m_line++;
+				m_pos++;
+				m_lineStart = true;
+				continue;
+			}
+
+			if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v')
+			{
+				m_pos++;
+				continue;
+			}
+
+			// preprocessor output
+			if (c == '#' && m_lineStart)
+			{
+				while (m_pos < m_end && *m_pos != '\n')
+					m_pos++;
+				continue;
+			}
+
+			if (c == '/' && m_pos + 1 < m_end)
+			{
+				if (m_pos[1] == '/')
+				{
+					while (m_pos < m_end && *m_pos != '\n')
+						m_pos++;
+					continue;
+				}
+
+				if (m_pos[1] == '*')
+				{
+					m_pos += 2;
+					while (m_pos + 1 < m_end && !(m_pos[0] == '*' && m_pos[1] == '/'))
+					{
+						if (*m_pos == '\n')
+							m_line++;
+						m_pos++;
+					}
+					m_pos = qMin(m_pos + 2, m_end);
+					continue;
+				}
+			}
+
+			break;
+		}
+	}
+
+	DotToken read()
+	{
+		skipSpaces();
+
+		m_lineStart = false;
+
+		DotToken t;
+		if (m_pos >= m_end)
+			return t;
+
+		t.ptr = m_pos;
+		t.len = 1;
+
+		switch (*m_pos)
+		{
+		case '{':	t.type = DotToken::LBrace; break;
+		case '}':	t.type = DotToken::RBrace; break;
+		case '[':	t.type = DotToken::LBracket; break;
+		case ']':	t.type = DotToken::RBracket; break;
+		case ';':	t.type = DotToken::Semicolon; break;
+		case ',':	t.type = DotToken::Comma; break;
+		case ':':	t.type = DotToken::Colon; break;
+		case '=':	t.type = DotToken::Equal; break;
+
+		case '"':
+			return readQuoted();
+
+		case '<':
+			return readHtml();
+
+		case '-':
+			if (m_pos + 1 < m_end && (m_pos[1] == '-' || m_pos[1] == '>'))
+			{
+				t.type = DotToken::EdgeOp;
+				t.len = 2;
+				m_pos += 2;
+				return t;
+			}
+			// negative numeral
+			m_pos++;
+			while (m_pos < m_end && isIdChar(*m_pos))
+				m_pos++;
+			t.type = DotToken::Id;
+			t.len = int(m_pos - t.ptr);
+			return t;
+
+		default:
+			if (!isIdChar(*m_pos))
+			{
+				t.type = DotToken::Error;
+				return t;
+			}
+
+			while (m_pos < m_end && isIdChar(*m_pos))
+				m_pos++;
+			t.type = DotToken::Id;
+			t.len = int(m_pos - t.ptr);
+			return t;
+		}
+
+		m_pos++;
+		return t;
+	}
+
+	DotToken readQuoted()
+	{
+		DotToken t;
+		t.type = DotToken::Quoted;
+		t.ptr = ++m_pos;
+
+		for (;;)
+		{
+			while (m_pos < m_end && *m_pos != '"')
+			{
+				if (*m_pos == '\\' && m_pos + 1 < m_end)
+				{
+					t.escaped = true;
+					m_pos++;
+				}
+
+				if (*m_pos == '\n')
+					m_line++;
+
+				m_pos++;
+			}
+
+			if (m_pos >= m_end)
+			{
+				t.type = DotToken::Error;
+				return t;
+			}
+
+			t.len = int(m_pos - t.ptr);
+			m_pos++;	// closing "
+
+			// "a" + "b": the token spans all the parts
+			const char *pos = m_pos;
+			int line = m_line;
+			bool lineStart = m_lineStart;
+
+			skipSpaces();
+			if (m_pos < m_end && *m_pos == '+')
+			{
+				m_pos++;
+				skipSpaces();
+				if (m_pos < m_end && *m_pos == '"')
+				{
+					t.escaped = true;
+					m_pos++;
+					continue;
+				}
+			}
+
+			m_pos = pos;
+			m_line = line;
+			m_lineStart = lineStart;
+			return t;
+		}
+	}
+
+	DotToken readHtml()
+	{
+		// taken as is, without the outer <>
+		DotToken t;
+		t.type = DotToken::Html;
+		t.ptr = ++m_pos;
+
+		int depth = 1;
+		while (m_pos < m_end)
+		{
+			if (*m_pos == '<')
+				depth++;
+			else if (*m_pos == '>' && --depth == 0)
+				break;
+			else if (*m_pos == '\n')
+				m_line++;
+
+			m_pos++;
+		}
+
+		if (m_pos >= m_end)
+		{
+			t.type = DotToken::Error;
+			return t;
+		}
+
+		t.len = int(m_pos - t.ptr);
+		m_pos++;	// closing >
+		return t;
+	}
+
+	const char *m_pos;
+	const char *m_end;
+	int m_line = 1;
+	bool m_lineStart = true;
+
+	DotToken m_peeked;
+	bool m_hasPeeked = false;
+};
+
+
+class DotParser
+{
+public:
+	DotParser(const char *data, int size, Graph &g): m_tokens(data, size), m_graph(g) {}
+
+	bool parse()
+	{
+		// [strict] (graph | digraph) [ID] '{' stmt_list '}'
+		DotToken t = m_tokens.next();
+		if (t.isKeyword("strict"))
+			t = m_tokens.next();
+
+		if (t.isKeyword("digraph"))
+			m_directed = true;
+		else if (!t.isKeyword("graph"))
+			return error("graph or digraph expected");
+
+		if (m_tokens.peek().isId())
+			m_tokens.next();
+
+		if (m_tokens.next().type != DotToken::LBrace)
+			return error("{ expected");
+
+		Scope scope;
+		if (!parseStmtList(scope, nullptr))
+			return false;
+
+		if (!m_directed)
+		{
+			AttrInfo direction;
+			direction.id = "direction";
+			direction.name = "Direction";
+			direction.valueType = QVariant::String;
+			direction.defaultValue = QString("undirected");
+			m_graph.edgeAttrs["direction"] = direction;
+		}
+
+		return true;
+	}
+
+	QString errorString() const
+	{
+		return m_error;
+	}
+
+private:
+	typedef QVector<QPair<QByteArray, QByteArray>> AttrList;
+
+	// defaults of the current (sub)graph
+	struct Scope
+	{
+		AttrList nodeDefaults;
+		AttrList edgeDefaults;
+	};
+
+	struct EndPoint
+	{
+		int nodeIndex;
+		QByteArray portId;
+	};
+
+	typedef QVector<EndPoint> Operand;
+
+	bool error(const char *message)
+	{
+		m_error = QObject::tr("DOT: %1 at line %2").arg(message).arg(m_tokens.line());
+		return false;
+	}
+
+	// string value: raw data if possible
+	static QByteArray text(const DotToken &t)
+	{
+		return t.escaped ? unescape(t) : QByteArray::fromRawData(t.ptr, t.len);
+	}
+
+	static QByteArray unescape(const DotToken &t)
+	{
+		QByteArray s;
+		s.reserve(t.len);
+
+		for (int i = 0; i < t.len; ++i)
+		{
+			char c = t.ptr[i];
+
+			// skip the closing & opening quotes of the concatenated parts
+			if (c == '"')
+			{
+				while (++i < t.len && t.ptr[i] != '"');
+				continue;
+			}
+
+			if (c != '\\' || i + 1 == t.len)
+			{
+				s += c;
+				continue;
+			}
+
+			char e = t.ptr[++i];
+			switch (e)
+			{
+			case '"':	s += '"'; break;
+			case '\n':	break;	// line continuation
+			case '\r':	if (i + 1 < t.len && t.ptr[i + 1] == '\n') i++; break;
+			case 'n':
+			case 'l':
+			case 'r':	s += '\n'; break;
+			default:	s += '\\'; s += e; break;
+			}
+		}
+
+		return s;
+	}
+
+	bool parseStmtList(Scope &scope, Operand *members)
+	{
+		for (;;)
+		{
+			const DotToken &t = m_tokens.peek();
+
+			if (t.type == DotToken::RBrace)
+			{
+				m_tokens.next();
+				return true;
+			}
+
+			if (t.type == DotToken::Semicolon)
+			{
+				m_tokens.next();
+				continue;
+			}
+
+			if (t.type == DotToken::End)
+				return error("} expected");
+
+			if (!parseStmt(scope, members))
+				return false;
+		}
+	}
+
+	bool parseStmt(Scope &scope, Operand *members)
+	{
+		DotToken t = m_tokens.peek();
+
+		// attr_stmt: (graph | node | edge) attr_list
+		if (t.isKeyword("graph") || t.isKeyword("node") || t.isKeyword("edge"))
+		{
+			m_tokens.next();
+
+			AttrList attrs;
+			if (!parseAttrList(attrs))
+				return false;
+
+			if (t.isKeyword("node"))
+				scope.nodeDefaults += attrs;
+			else if (t.isKeyword("edge"))
+				scope.edgeDefaults += attrs;
+
+			// graph attributes are not used
+
+			return true;
+		}
+
+		// ID '=' ID
+		if (t.isId())
+		{
+			m_tokens.next();
+
+			if (m_tokens.peek().type == DotToken::Equal)
+			{
+				m_tokens.next();
+				if (!m_tokens.next().isId())
+					return error("value expected");
+
+				// graph attributes are not used
+				return true;
+			}
+		}
+
+		// node_stmt or edge_stmt
+		Operand operand;
+		if (!parseOperand(t, scope, members, operand))
+			return false;
+
+		if (m_tokens.peek().type != DotToken::EdgeOp)
+		{
+			AttrList attrs;
+			if (!parseAttrList(attrs))
+				return false;
+
+			for (const EndPoint &p : operand)
+			{
+				applyNodeAttrs(attrs, m_graph.nodes[p.nodeIndex].attrs);
+			}
+
+			return true;
+		}
+
+		// edge chain
+		QVector<Operand> chain;
+		chain << operand;
+
+		while (m_tokens.peek().type == DotToken::EdgeOp)
+		{
+			m_tokens.next();
+
+			DotToken next = m_tokens.peek();
+			if (next.isId())
+				m_tokens.next();
+
+			Operand target;
+			if (!parseOperand(next, scope, members, target))
+				return false;
+
+			chain << target;
+		}
+
+		AttrList attrs;
+		if (!parseAttrList(attrs))
+			return false;
+
+		// ids must stay unique: no id from the defaults, only the first edge of the chain gets its own one,
+		// the others are given generated ids
+		Edge proto;
+		applyEdgeAttrs(scope.edgeDefaults, proto);
+		proto.id.clear();
+		applyEdgeAttrs(attrs, proto);
+
+		for (int i = 1; i < chain.size(); ++i)
+		{
+			for (const EndPoint &from : chain.at(i - 1))
+			{
+				for (const EndPoint &to : chain.at(i))
+				{
+					Edge e(proto);
+					e.startNodeId = m_graph.nodes.at(from.nodeIndex).id;
+					e.startPortId = from.portId;
+					e.endNodeId = m_graph.nodes.at(to.nodeIndex).id;
+					e.endPortId = to.portId;
 
-#else
+					m_graph.edges.append(e);
+
+					proto.id.clear();
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// node_id or subgraph; t is the already consumed ID (if any)
+	bool parseOperand(const DotToken &t, Scope &scope, Operand *members, Operand &operand)
+	{
+		if (t.isKeyword("subgraph") || t.type == DotToken::LBrace)
+		{
+			if (t.isKeyword("subgraph") && m_tokens.peek().isId())
+				m_tokens.next();
+
+			if (m_tokens.next().type != DotToken::LBrace)
+				return error("{ expected");
+
+			// own defaults, inherited from the parent
+			Scope subScope(scope);
+			if (!parseStmtList(subScope, &operand))
+				return false;
+
+			if (members)
+				*members += operand;
+
+			return true;
+		}
+
+		if (!t.isId())
+			return error("node id expected");
+
+		EndPoint p;
+		p.nodeIndex = nodeIndex(text(t), scope);
+
+		// port: ':' ID [':' compass_pt]
+		if (m_tokens.peek().type == DotToken::Colon)
+		{
+			m_tokens.next();
+
+			DotToken port = m_tokens.next();
+			if (!port.isId())
+				return error("port expected");
+
+			QByteArray portId = text(port);
+			p.portId = QByteArray(portId.constData(), portId.size());
+
+			if (m_tokens.peek().type == DotToken::Colon)
+			{
+				m_tokens.next();
+				if (!m_tokens.next().isId())
+					return error("compass point expected");
+			}
+
+			// only compass point is given
+			static const QByteArrayList compass = { "n", "ne", "e", "se", "s", "sw", "w", "nw", "c", "_" };
+			if (compass.contains(p.portId))
+				p.portId.clear();
+		}
+
+		operand << p;
+
+		if (members)
+			*members << p;
+
+		return true;
+	}
+
+	bool parseAttrList(AttrList &attrs)
+	{
+		// ('[' [a_list] ']')*
+		while (m_tokens.peek().type == DotToken::LBracket)
+		{
+			m_tokens.next();
+
+			for (;;)
+			{
+				DotToken t = m_tokens.next();
+
+				if (t.type == DotToken::RBracket)
+					break;
+
+				if (t.type == DotToken::Comma || t.type == DotToken::Semicolon)
+					continue;
+
+				if (!t.isId())
+					return error("attribute expected");
+
+				QByteArray name = text(t);
+
+				if (m_tokens.peek().type != DotToken::Equal)
+				{
+					// boolean attribute
+					attrs << qMakePair(name, QByteArray("true"));
+					continue;
+				}
+
+				m_tokens.next();
+
+				DotToken value = m_tokens.next();
+				if (!value.isId())
+					return error("attribute value expected");
+
+				attrs << qMakePair(name, text(value));
+			}
+		}
+
+		return true;
+	}
+
+	int nodeIndex(const QByteArray &id, const Scope &scope)
+	{
+		auto it = m_nodeIndex.constFind(id);
+		if (it != m_nodeIndex.constEnd())
+			return it.value();
+
+		// new node: current defaults are applied
+		Node n;
+		n.id = QByteArray(id.constData(), id.size());
+		applyNodeAttrs(scope.nodeDefaults, n.attrs);
+
+		int index = m_graph.nodes.size();
+		m_graph.nodes.append(n);
+		m_nodeIndex[n.id] = index;
+
+		return index;
+	}
+
+	static QString toString(const QByteArray &value)
+	{
+		return QString::fromUtf8(value.constData(), value.size());
+	}
+
+	static void applyLabelAttr(const QByteArray &name, const QByteArray &value, GraphAttributes &attrs)
+	{
+		if (name == "label")
+		{
+			attrs["label"] = toString(value);
+		}
+		else if (name == "xlabel")
+		{
+			if (!attrs.contains("label"))
+				attrs["label"] = toString(value);
+		}
+		else if (name == "fontcolor")
+		{
+			attrs["label.color"] = QColor(toString(value));
+		}
+		else if (name == "fontname")
+		{
+			QFont f = attrs.value("label.font").value<QFont>();
+			fromDotFontName(toString(value), f);
+			attrs["label.font"] = f;
+		}
+		else if (name == "fontsize")
+		{
+			float size = value.toFloat();
+			if (size > .0)
+			{
+				QFont f = attrs.value("label.font").value<QFont>();
+				f.setPointSizeF(size);
+				attrs["label.font"] = f;
+			}
+		}
+	}
+
+	static void applyNodeAttrs(const AttrList &list, GraphAttributes &attrs)
+	{
+		for (const auto &attr : list)
+		{
+			const QByteArray &name = attr.first;
+			const QByteArray &value = attr.second;
+
+			if (name == "fillcolor")
+			{
+				attrs["color"] = QColor(toString(value));
+			}
+			else if (name == "width" || name == "height")
+			{
+				float v = value.toFloat();
+				if (v > .0)
+					attrs[QByteArray(name.constData(), name.size())] = v * 72.0;
+			}
+			else if (name == "pos")
+			{
+				float x = 0, y = 0;
+				QByteArray pos(value.constData(), value.size());
+				if (std::sscanf(pos.constData(), "%f,%f", &x, &y) == 2)
+				{
+					attrs["x"] = x * 72.0;
+					attrs["y"] = -y * 72.0;
+				}
+			}
+			else if (name == "shape")
+			{
+				attrs["shape"] = fromDotShape(toString(value));
+			}
+			else if (name == "color")
+			{
+				attrs["stroke.color"] = QColor(toString(value));
+			}
+			else if (name == "style")
+			{
+				attrs["stroke.style"] = toString(value);
+			}
+			else if (name == "penwidth")
+			{
+				float v = value.toFloat();
+				if (v > .0)
+					attrs["stroke.size"] = v;
+			}
+			else
+			{
+				applyLabelAttr(name, value, attrs);
+			}
+		}
+	}
+
+	static void applyEdgeAttrs(const AttrList &list, Edge &e)
+	{
+		for (const auto &attr : list)
+		{
+			const QByteArray &name = attr.first;
+			const QByteArray &value = attr.second;
+
+			if (name == "id")
+			{
+				e.id = QByteArray(value.constData(), value.size());
+			}
+			else if (name == "weight")
+			{
+				float v = value.toFloat();
+				if (v > .0)
+					e.attrs["weight"] = v;
+			}
+			else if (name == "penwidth")
+			{
+				float v = value.toFloat();
+				if (v > .0 && !e.attrs.contains("weight"))
+					e.attrs["weight"] = v;
+			}
+			else if (name == "dir")
+			{
+				if (value == "both")
+					e.attrs["direction"] = "mutual";
+				else if (value == "none")
+					e.attrs["direction"] = "undirected";
+				else
+					e.attrs["direction"] = "directed";
+			}
+			else if (name == "color")
+			{
+				e.attrs["color"] = QColor(toString(value));
+			}
+			else if (name == "style")
+			{
+				e.attrs["style"] = toString(value);
+			}
+			else
+			{
+				applyLabelAttr(name, value, e.attrs);
+			}
+		}
+	}
+
+	DotTokenizer m_tokens;
+	Graph &m_graph;
+	bool m_directed = false;
+
+	QHash<QByteArray, int> m_nodeIndex;
+	QString m_error;
+};
+
+
+static bool loadNative(const char *data, int size, Graph& g, QString* lastError)
+{
+	DotParser parser(data, size, g);
+	if (parser.parse())
+		return true;
+
+	if (lastError)
+		*lastError = parser.errorString();
+
+	g.clear();
 	return false;
-#endif
 }
 
 
+// reimp
+
+bool CFormatDOT::load(const QString& fileName, Graph& g, QString* lastError) const
+{
+	QFile file(fileName);
+	if (!file.open(QFile::ReadOnly))
+	{
+		if (lastError)
+			*lastError = QObject::tr("Cannot open file");
+
+		return false;
+	}
+
+	// the tokenizer works with int offsets
+	if (file.size() > std::numeric_limits<int>::max())
+	{
+		if (lastError)
+			*lastError = QObject::tr("File is too large");
+
+		return false;
+	}
+
+	g.clear();
+
+	// map the file if possible, else read it at once
+	QByteArray content;
+	uchar *mapped = file.size() ? file.map(0, file.size()) : nullptr;
+	const char *data = reinterpret_cast<const char*>(mapped);
+	int size = int(file.size());
+
+	if (!mapped)
+	{
+		content = file.readAll();
+		data = content.constData();
+		size = content.size();
+	}
+
+	bool status = loadNative(data, size, g, lastError);
+
+	if (mapped)
+		file.unmap(mapped);
+
+	// done
+	return status;
+}
+
+
+#ifdef USE_BOOST
+
+bool CFormatDOT::loadBoost(const QString& fileName, Graph& g, QString* lastError) const
+{
+	return loadViaBoost(fileName, g, lastError);
+}
+
+#endif
+
+
 bool CFormatDOT::save(const QString& fileName, Graph& graph, QString* lastError) const
 {
 	return false;
 }
-
@@ -17,6 +17,11 @@ class CFormatDOT
 public:
 	bool load(const QString& fileName, Graph& graph, QString* lastError = nullptr) const;
 	bool save(const QString& fileName, Graph& graph, QString* lastError = nullptr) const;
+
+#ifdef USE_BOOST
+	// the former Boost.Graph based reader, kept as a reference (see qvgeiobench)
+	bool loadBoost(const QString& fileName, Graph& graph, QString* lastError = nullptr) const;
+#endif
 };
 
 
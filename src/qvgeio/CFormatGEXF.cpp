@@ -0,0 +1,725 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include "CFormatGEXF.h"
+
+#include <QFile>
+#include <QSet>
+#include <QDate>
+#include <QSizeF>
+#include <QCoreApplication>
+
+
+// visible labels of a class (same as attr_labels_visIds of the scene), stored as "_vis_" attribute
+static const QByteArray visIds = QByteArrayLiteral("labels.visibleIds");
+
+
+static QStringRef localName(const QXmlStreamReader &xsr)
+{
+	// namespaces are not processed: viz: (v1.2), ns0: (v1.1) and qvge: prefixes are skipped
+	QStringRef name = xsr.qualifiedName();
+	int colon = name.indexOf(':');
+	return colon < 0 ? name : name.mid(colon + 1);
+}
+
+
+static int stringToType(const QStringRef &type)
+{
+	if (type == QLatin1String("integer") || type == QLatin1String("long"))
+		return QVariant::Int;
+
+	if (type == QLatin1String("double") || type == QLatin1String("float"))
+		return QVariant::Double;
+
+	if (type == QLatin1String("boolean"))
+		return QVariant::Bool;
+
+	if (type == QLatin1String("liststring"))
+		return QVariant::StringList;
+
+	return QVariant::String;
+}
+
+
+static QString typeToString(int valueType)
+{
+	switch (valueType)
+	{
+	case QMetaType::Bool:
+		return "boolean";
+
+	case QMetaType::Int:
+	case QMetaType::UInt:
+		return "integer";
+
+	case QMetaType::Long:
+	case QMetaType::ULong:
+	case QMetaType::LongLong:
+		return "long";
+
+	case QMetaType::Double:
+		return "double";
+
+	case QMetaType::Float:
+		return "float";
+
+	case QMetaType::QStringList:
+		return "liststring";
+
+	default:
+		return "string";
+	}
+}
+
+
+static QVariant textToValue(const QString &text, int valueType)
+{
+	switch (valueType)
+	{
+	case QVariant::StringList:
+		return text.split('|', QString::SkipEmptyParts);
+
+	case QVariant::Int:
+		return text.toInt();
+
+	case QVariant::Double:
+		return text.toDouble();
+
+	case QVariant::Bool:
+		return text.toLower() == "true" || text == "1";
+
+	default:
+		return text;
+	}
+}
+
+
+static QString valueToText(const QVariant &value)
+{
+	if (value.type() == QVariant::StringList)
+		return value.toStringList().join('|');
+
+	return value.toString();
+}
+
+
+// reimp
+
+bool CFormatGEXF::load(const QString& fileName, Graph& graph, QString* lastError) const
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	// try to parse: single pass, no DOM
+	graph.clear();
+
+	ReadContext ctx(graph);
+
+	QXmlStreamReader xsr(&file);
+	xsr.setNamespaceProcessing(false);	// qvge: prefix is never declared
+
+	if (xsr.readNextStartElement())
+		readElement(xsr, ctx);
+
+	if (xsr.hasError())
+	{
+		if (lastError)
+			*lastError = QObject::tr("%1\nline: %2, column: %3").arg(xsr.errorString()).arg(xsr.lineNumber()).arg(xsr.columnNumber());
+
+		graph.clear();
+		return false;
+	}
+
+	// default direction of the edges
+	AttrInfo& direction = graph.edgeAttrs["direction"];
+	if (direction.id.isEmpty())
+	{
+		direction.id = "direction";
+		direction.name = "Direction";
+		direction.valueType = QVariant::String;
+	}
+	direction.defaultValue = ctx.edgeType.isEmpty() ? QString("undirected") : ctx.edgeType;
+
+	return true;
+}
+
+
+void CFormatGEXF::readElement(QXmlStreamReader &xsr, ReadContext &ctx) const
+{
+	const auto name = localName(xsr);
+
+	if (name == QLatin1String("node"))
+	{
+		readNode(xsr, ctx);
+	}
+	else if (name == QLatin1String("edge"))
+	{
+		readEdge(xsr, ctx);
+	}
+	else if (name == QLatin1String("attributes"))
+	{
+		readAttrs(xsr, ctx);
+	}
+	else if (name == QLatin1String("graph"))
+	{
+		if (ctx.edgeType.isEmpty())
+			ctx.edgeType = xsr.attributes().value(QLatin1String("defaultedgetype")).toString();
+
+		readContent(xsr, ctx);
+	}
+	else
+	{
+		// gexf root, nodes, edges & unknown extensions: look inside
+		readContent(xsr, ctx);
+	}
+}
+
+
+void CFormatGEXF::readContent(QXmlStreamReader &xsr, ReadContext &ctx) const
+{
+	while (xsr.readNextStartElement())
+		readElement(xsr, ctx);
+}
+
+
+void CFormatGEXF::readAttrs(QXmlStreamReader &xsr, ReadContext &ctx) const
+{
+	QByteArray classId = xsr.attributes().value(QLatin1String("class")).toLatin1().toLower();
+	if (classId == "graph")
+		classId = "";
+
+	while (xsr.readNextStartElement())
+	{
+		if (localName(xsr) == QLatin1String("attribute"))
+			readAttr(xsr, ctx, classId);
+		else
+			xsr.skipCurrentElement();
+	}
+}
+
+
+bool CFormatGEXF::readAttr(QXmlStreamReader &xsr, ReadContext &ctx, const QByteArray &classId) const
+{
+	auto attrs = xsr.attributes();
+
+	QByteArray id = attrs.value(QLatin1String("id")).toLatin1();
+	QString title = attrs.value(QLatin1String("title")).toString();
+	int valueType = stringToType(attrs.value(QLatin1String("type")));
+
+	QString def;
+	bool hasDefault = false;
+	while (xsr.readNextStartElement())
+	{
+		if (localName(xsr) == QLatin1String("default"))
+		{
+			def = xsr.readElementText(QXmlStreamReader::IncludeChildElements);
+			hasDefault = true;
+		}
+		else
+			xsr.skipCurrentElement();
+	}
+
+	if (id.isEmpty())
+		return false;
+
+	AttrInfo attr;
+	attr.id = title.isEmpty() ? id : title.toLatin1();
+	attr.name = title.isEmpty() ? QString(id) : title;
+	attr.valueType = valueType;
+
+	if (hasDefault)
+		attr.defaultValue = textToValue(def, valueType);
+
+	AttributeInfos& attrInfos =
+		(classId == "node") ? ctx.graph.nodeAttrs :
+		(classId == "edge") ? ctx.graph.edgeAttrs :
+		ctx.graph.graphAttrs;
+
+	// visibility attr
+	if (attr.id == "_vis_")
+	{
+		AttrInfo visAttr;
+		visAttr.id = visIds;
+		visAttr.name = "Visible Labels";
+		visAttr.valueType = QVariant::StringList;
+		visAttr.defaultValue = def;
+		attrInfos[visIds] = visAttr;
+		return true;
+	}
+
+	if (hasDefault && attr.id == "size" && classId == "node")
+	{
+		double v = def.toDouble();
+		attr.defaultValue = QSizeF(v, v);
+	}
+
+	attrInfos[attr.id] = attr;
+
+	ctx.cia[classId][id] = attr;
+
+	return true;
+}
+
+
+void CFormatGEXF::readAttValues(QXmlStreamReader &xsr, const IdToAttrMap &idMap, GraphAttributes &attrs) const
+{
+	while (xsr.readNextStartElement())
+	{
+		if (localName(xsr) == QLatin1String("attvalue"))
+		{
+			auto xmlAttrs = xsr.attributes();
+
+			QByteArray id = xmlAttrs.value(QLatin1String("id")).toLatin1();		// v1.2
+			if (id.isEmpty())
+				id = xmlAttrs.value(QLatin1String("for")).toLatin1();			// v1.1
+
+			auto it = idMap.constFind(id);
+			if (it != idMap.constEnd())		// else error: not valid id
+			{
+				attrs[it->id] = textToValue(xmlAttrs.value(QLatin1String("value")).toString(), it->valueType);
+			}
+		}
+
+		xsr.skipCurrentElement();
+	}
+}
+
+
+bool CFormatGEXF::readNode(QXmlStreamReader &xsr, ReadContext &ctx) const
+{
+	// keep the document order with nested nodes
+	int index = ctx.graph.nodes.size();
+	ctx.graph.nodes.append(Node());
+
+	Node node;
+
+	// common attrs
+	auto attrs = xsr.attributes();
+	node.id = attrs.value(QLatin1String("id")).toLatin1();
+
+	if (attrs.hasAttribute(QLatin1String("label")))
+		node.attrs["label"] = attrs.value(QLatin1String("label")).toString();
+
+	// viz: attrs (v1.2), ns0: attrs (v1.1)
+	while (xsr.readNextStartElement())
+	{
+		const auto name = localName(xsr);
+		auto vizAttrs = xsr.attributes();
+
+		if (name == QLatin1String("attvalues"))
+		{
+			readAttValues(xsr, ctx.cia["node"], node.attrs);
+			continue;
+		}
+
+		if (name == QLatin1String("position"))
+		{
+			node.attrs["x"] = vizAttrs.value(QLatin1String("x")).toDouble();
+			node.attrs["y"] = vizAttrs.value(QLatin1String("y")).toDouble();
+			if (vizAttrs.hasAttribute(QLatin1String("z")))
+				node.attrs["z"] = vizAttrs.value(QLatin1String("z")).toDouble();
+		}
+		else if (name == QLatin1String("color"))
+		{
+			QColor color(vizAttrs.value(QLatin1String("r")).toInt(), vizAttrs.value(QLatin1String("g")).toInt(), vizAttrs.value(QLatin1String("b")).toInt());
+			if (vizAttrs.hasAttribute(QLatin1String("a")))
+				color.setAlphaF(vizAttrs.value(QLatin1String("a")).toDouble());
+			node.attrs["color"] = color;
+		}
+		else if (name == QLatin1String("size"))
+		{
+			double v = vizAttrs.value(QLatin1String("value")).toDouble();
+			QSizeF sz(v, v);
+
+			// non-standard extension
+			if (vizAttrs.hasAttribute(QLatin1String("width")))
+				sz.setWidth(vizAttrs.value(QLatin1String("width")).toDouble());
+			if (vizAttrs.hasAttribute(QLatin1String("height")))
+				sz.setHeight(vizAttrs.value(QLatin1String("height")).toDouble());
+
+			if (!sz.isEmpty())
+				node.attrs["size"] = sz;
+		}
+		else if (name == QLatin1String("shape"))
+		{
+			QString shape = vizAttrs.value(QLatin1String("value")).toString();
+			node.attrs["shape"] = shape.isEmpty() ? QString("disc") : shape;
+		}
+		else
+		{
+			// nested nodes etc.
+			readElement(xsr, ctx);
+			continue;
+		}
+
+		xsr.skipCurrentElement();
+	}
+
+	ctx.graph.nodes[index] = node;
+
+	return true;
+}
+
+
+bool CFormatGEXF::readEdge(QXmlStreamReader &xsr, ReadContext &ctx) const
+{
+	auto attrs = xsr.attributes();
+
+	Edge edge;
+	edge.id = attrs.value(QLatin1String("id")).toLatin1();
+	edge.startNodeId = attrs.value(QLatin1String("source")).toLatin1();
+	edge.endNodeId = attrs.value(QLatin1String("target")).toLatin1();
+
+	// common attrs
+	if (attrs.hasAttribute(QLatin1String("label")))
+		edge.attrs["label"] = attrs.value(QLatin1String("label")).toString();
+
+	if (attrs.hasAttribute(QLatin1String("weight")))
+	{
+		double weight = attrs.value(QLatin1String("weight")).toDouble();
+		if (weight >= 0)
+			edge.attrs["weight"] = weight;
+	}
+
+	// direction (else the default one)
+	QString edgeType = attrs.value(QLatin1String("edgetype")).toString();
+	if (edgeType.size())
+		edge.attrs["direction"] = edgeType;
+
+	while (xsr.readNextStartElement())
+	{
+		const auto name = localName(xsr);
+		auto vizAttrs = xsr.attributes();
+
+		if (name == QLatin1String("attvalues"))
+		{
+			readAttValues(xsr, ctx.cia["edge"], edge.attrs);
+			continue;
+		}
+
+		if (name == QLatin1String("color"))
+		{
+			QColor color(vizAttrs.value(QLatin1String("r")).toInt(), vizAttrs.value(QLatin1String("g")).toInt(), vizAttrs.value(QLatin1String("b")).toInt());
+			if (vizAttrs.hasAttribute(QLatin1String("a")))
+				color.setAlphaF(vizAttrs.value(QLatin1String("a")).toDouble());
+			edge.attrs["color"] = color;
+		}
+		else if (name == QLatin1String("thickness"))
+		{
+			edge.attrs["thickness"] = vizAttrs.value(QLatin1String("value")).toFloat();
+		}
+		else if (name == QLatin1String("shape"))
+		{
+			QString style = vizAttrs.value(QLatin1String("value")).toString();
+			edge.attrs["style"] = style.isEmpty() ? QString("solid") : style;
+		}
+		else if (name == QLatin1String("points"))
+		{
+			// polypoints (qvge specific: not a part of v1.2)
+			edge.attrs["points"] = vizAttrs.value(QLatin1String("data")).toString();
+		}
+		else
+		{
+			readElement(xsr, ctx);
+			continue;
+		}
+
+		xsr.skipCurrentElement();
+	}
+
+	ctx.graph.edges.append(edge);
+
+	return true;
+}
+
+
+bool CFormatGEXF::save(const QString& fileName, Graph& graph, QString* lastError) const
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		if (lastError)
+			*lastError = QString("%1: File cannot be opened for writing").arg(fileName);
+
+		return false;
+	}
+
+	QXmlStreamWriter xsw(&file);
+	xsw.setCodec("UTF-8");
+	xsw.setAutoFormatting(true);
+	xsw.setAutoFormattingIndent(4);
+
+	xsw.writeStartDocument();
+	xsw.writeStartElement("gexf");
+	xsw.writeAttribute("xmlns", "http://www.gexf.net/1.2draft");
+	xsw.writeAttribute("version", "1.2");
+	xsw.writeAttribute("xmlns:viz", "http://www.gexf.net/1.2draft/viz");
+	xsw.writeAttribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
+	xsw.writeAttribute("xsi:schemaLocation", "http://www.gexf.net/1.2draft http://www.gexf.net/1.2draft/gexf.xsd");
+
+	// meta
+	xsw.writeStartElement("meta");
+	xsw.writeAttribute("lastmodifieddate", QDate::currentDate().toString(Qt::ISODate));
+	xsw.writeTextElement("creator", QCoreApplication::applicationName());
+	xsw.writeTextElement("description", graph.graphAttrs.value("comment").defaultValue.toString());
+	xsw.writeEndElement();	// meta
+
+	// graph
+	xsw.writeStartElement("graph");
+	xsw.writeAttribute("mode", "static");
+
+	QString edgeType = graph.edgeAttrs.value("direction").defaultValue.toString();
+	if (edgeType.size())
+		xsw.writeAttribute("defaultedgetype", edgeType);
+
+	// attrs
+	writeClassAttrs(xsw, graph, "");
+	writeClassAttrs(xsw, graph, "node");
+	writeClassAttrs(xsw, graph, "edge");
+
+	// nodes
+	writeNodes(xsw, graph);
+
+	// edges
+	writeEdges(xsw, graph);
+
+	xsw.writeEndElement();	// graph
+
+	xsw.writeEndElement();	// gexf
+	xsw.writeEndDocument();
+
+	return true;
+}
+
+
+void CFormatGEXF::writeClassAttrs(QXmlStreamWriter &xsw, const Graph& graph, const QByteArray &classId) const
+{
+	AttributeInfos attrs =
+		(classId == "node") ? graph.nodeAttrs :
+		(classId == "edge") ? graph.edgeAttrs :
+		graph.graphAttrs;
+
+	// add local attributes if any (except of written as viz: & common ones)
+	static const QSet<QByteArray> nodeMapped = { "label", "x", "y", "z", "size", "width", "height", "color", "shape" };
+	static const QSet<QByteArray> edgeMapped = { "label", "direction", "thickness", "color", "style", "points" };
+
+	auto addLocalAttrs = [&attrs](const GraphAttributes& itemAttrs, const QSet<QByteArray>& mapped)
+	{
+		for (auto it = itemAttrs.constBegin(); it != itemAttrs.constEnd(); ++it)
+		{
+			if (!attrs.contains(it.key()) && !mapped.contains(it.key()))
+			{
+				AttrInfo attr;
+				attr.id = it.key();
+				attr.name = it.key();
+				attr.valueType = QVariant::String;
+				attrs[it.key()] = attr;
+			}
+		}
+	};
+
+	if (classId == "node")
+	{
+		for (const auto& node : graph.nodes)
+			addLocalAttrs(node.attrs, nodeMapped);
+	}
+	else if (classId == "edge")
+	{
+		for (const auto& edge : graph.edges)
+			addLocalAttrs(edge.attrs, edgeMapped);
+	}
+
+	if (attrs.isEmpty())
+		return;
+
+	xsw.writeStartElement("attributes");
+	xsw.writeAttribute("class", classId);
+	xsw.writeAttribute("mode", "static");
+
+	for (auto it = attrs.constBegin(); it != attrs.constEnd(); ++it)
+	{
+		const auto &attr = it.value();
+
+		xsw.writeStartElement("attribute");
+
+		// visible state
+		if (it.key() == visIds)
+		{
+			xsw.writeAttribute("id", "_vis_");
+			xsw.writeAttribute("title", "_vis_");
+			xsw.writeAttribute("type", "liststring");
+			xsw.writeTextElement("default", valueToText(attr.defaultValue));
+			xsw.writeEndElement();	// attribute
+			continue;
+		}
+
+		// others (id = title)
+		xsw.writeAttribute("id", it.key());
+		xsw.writeAttribute("title", it.key());
+
+		// size
+		if (attr.defaultValue.type() == QVariant::SizeF)
+		{
+			QSizeF size = attr.defaultValue.toSizeF();
+			xsw.writeAttribute("type", "float");
+			xsw.writeTextElement("default", QString::number(qMax(size.width(), size.height())));
+		}
+		else
+		{
+			xsw.writeAttribute("type", typeToString(attr.valueType));
+
+			if (attr.defaultValue.isValid())
+				xsw.writeTextElement("default", valueToText(attr.defaultValue));
+		}
+
+		xsw.writeEndElement();	// attribute
+	}
+
+	xsw.writeEndElement();	// attributes
+}
+
+
+void CFormatGEXF::writeNodes(QXmlStreamWriter &xsw, const Graph& graph) const
+{
+	xsw.writeStartElement("nodes");
+
+	for (const auto& node : graph.nodes)
+	{
+		GraphAttributes nodeAttrs = node.attrs;
+
+		xsw.writeStartElement("node");
+		xsw.writeAttribute("id", node.id);
+
+		if (nodeAttrs.contains("label"))
+			xsw.writeAttribute("label", nodeAttrs.take("label").toString());
+
+		xsw.writeEmptyElement("viz:position");
+		xsw.writeAttribute("x", QString::number(nodeAttrs.take("x").toDouble()));
+		xsw.writeAttribute("y", QString::number(nodeAttrs.take("y").toDouble()));
+		if (nodeAttrs.contains("z"))
+			xsw.writeAttribute("z", QString::number(nodeAttrs.take("z").toDouble()));
+
+		QSizeF size = nodeAttrs.take("size").toSizeF();
+		if (nodeAttrs.contains("width"))
+			size.setWidth(nodeAttrs.take("width").toDouble());
+		if (nodeAttrs.contains("height"))
+			size.setHeight(nodeAttrs.take("height").toDouble());
+
+		if (!size.isEmpty())
+		{
+			xsw.writeEmptyElement("viz:size");
+			xsw.writeAttribute("value", QString::number(size.width()));
+
+			if (size.width() != size.height())
+			{
+				// non-standard extension
+				xsw.writeAttribute("width", QString::number(size.width()));
+				xsw.writeAttribute("height", QString::number(size.height()));
+			}
+		}
+
+		if (nodeAttrs.contains("color"))
+		{
+			QColor c = nodeAttrs.take("color").value<QColor>();
+			xsw.writeEmptyElement("viz:color");
+			xsw.writeAttribute("r", QString::number(c.red()));
+			xsw.writeAttribute("g", QString::number(c.green()));
+			xsw.writeAttribute("b", QString::number(c.blue()));
+		}
+
+		if (nodeAttrs.contains("shape"))
+		{
+			xsw.writeEmptyElement("viz:shape");
+			xsw.writeAttribute("value", nodeAttrs.take("shape").toString());
+		}
+
+		writeAttValues(xsw, nodeAttrs);
+
+		xsw.writeEndElement();	// node
+	}
+
+	xsw.writeEndElement();	// nodes
+}
+
+
+void CFormatGEXF::writeEdges(QXmlStreamWriter &xsw, const Graph& graph) const
+{
+	xsw.writeStartElement("edges");
+
+	for (const auto& edge : graph.edges)
+	{
+		GraphAttributes edgeAttrs = edge.attrs;
+
+		xsw.writeStartElement("edge");
+		xsw.writeAttribute("id", edge.id);
+
+		if (edgeAttrs.contains("label"))
+			xsw.writeAttribute("label", edgeAttrs.take("label").toString());
+
+		xsw.writeAttribute("source", edge.startNodeId);
+		xsw.writeAttribute("target", edge.endNodeId);
+
+		QString edgeType = edgeAttrs.take("direction").toString();
+		if (edgeType.size())
+			xsw.writeAttribute("edgetype", edgeType);
+
+		if (edgeAttrs.contains("thickness"))
+		{
+			xsw.writeEmptyElement("viz:thickness");
+			xsw.writeAttribute("value", QString::number(edgeAttrs.take("thickness").toFloat()));
+		}
+
+		if (edgeAttrs.contains("color"))
+		{
+			QColor c = edgeAttrs.take("color").value<QColor>();
+			xsw.writeEmptyElement("viz:color");
+			xsw.writeAttribute("r", QString::number(c.red()));
+			xsw.writeAttribute("g", QString::number(c.green()));
+			xsw.writeAttribute("b", QString::number(c.blue()));
+		}
+
+		if (edgeAttrs.contains("style"))
+		{
+			xsw.writeEmptyElement("viz:shape");
+			xsw.writeAttribute("value", edgeAttrs.take("style").toString());
+		}
+
+		// polypoints
+		if (edgeAttrs.contains("points"))
+		{
+			xsw.writeEmptyElement("qvge:points");
+			xsw.writeAttribute("data", edgeAttrs.take("points").toString());
+		}
+
+		writeAttValues(xsw, edgeAttrs);
+
+		xsw.writeEndElement();	// edge
+	}
+
+	xsw.writeEndElement();	// edges
+}
+
+
+void CFormatGEXF::writeAttValues(QXmlStreamWriter &xsw, const GraphAttributes& attvalues) const
+{
+	if (attvalues.isEmpty())
+		return;
+
+	xsw.writeStartElement("attvalues");
+
+	for (auto it = attvalues.constBegin(); it != attvalues.constEnd(); ++it)
+	{
+		xsw.writeEmptyElement("attvalue");
+		xsw.writeAttribute("for", it.key());
+		xsw.writeAttribute("value", valueToText(it.value()));
+	}
+
+	xsw.writeEndElement();	// attvalues
+}
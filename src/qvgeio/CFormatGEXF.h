@@ -0,0 +1,53 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QMap>
+#include <QByteArray>
+#include <QVariant>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include <qvgeio/CGraphBase.h>
+
+
+class CFormatGEXF
+{
+public:
+	bool load(const QString& fileName, Graph& graph, QString* lastError = nullptr) const;
+	bool save(const QString& fileName, Graph& graph, QString* lastError = nullptr) const;
+
+private:
+	typedef QMap<QByteArray, AttrInfo> IdToAttrMap;			// GEXF id:attr
+	typedef QMap<QByteArray, IdToAttrMap> ClassIdAttrMap;	// class <> (GEXF id:attr)
+
+	// single pass reading: every method consumes the current element
+	struct ReadContext
+	{
+		Graph &graph;
+		ClassIdAttrMap cia;
+		QString edgeType;
+
+		ReadContext(Graph &g): graph(g) {}
+	};
+
+	void readElement(QXmlStreamReader &xsr, ReadContext &ctx) const;
+	void readContent(QXmlStreamReader &xsr, ReadContext &ctx) const;
+	void readAttrs(QXmlStreamReader &xsr, ReadContext &ctx) const;
+	bool readAttr(QXmlStreamReader &xsr, ReadContext &ctx, const QByteArray &classId) const;
+	bool readNode(QXmlStreamReader &xsr, ReadContext &ctx) const;
+	bool readEdge(QXmlStreamReader &xsr, ReadContext &ctx) const;
+	void readAttValues(QXmlStreamReader &xsr, const IdToAttrMap &idMap, GraphAttributes &attrs) const;
+
+	void writeClassAttrs(QXmlStreamWriter &xsw, const Graph& graph, const QByteArray &classId) const;
+	void writeNodes(QXmlStreamWriter &xsw, const Graph& graph) const;
+	void writeEdges(QXmlStreamWriter &xsw, const Graph& graph) const;
+	void writeAttValues(QXmlStreamWriter &xsw, const GraphAttributes& attvalues) const;
+};
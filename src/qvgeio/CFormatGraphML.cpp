@@ -192,72 +192,101 @@ void CFormatGraphML::writeAttribute(QXmlStreamWriter &xsw, const QString &keyId,
 
 bool CFormatGraphML::load(const QString& fileName, Graph& graph, QString* lastError) const
 {
-	// read file into document
 	QFile file(fileName);
 	if (!file.open(QIODevice::ReadOnly))
 		return false;
 
-	QString errorString;
-	int errorLine, errorColumn;
+	// try to parse: single pass, no DOM
+	graph.clear();
+	m_edgeType.clear();
+
+	ReadContext ctx(graph);
 
-	QDomDocument doc("graphml");
-	if (!doc.setContent(&file, false, &errorString, &errorLine, &errorColumn))
+	QXmlStreamReader xsr(&file);
+	if (xsr.readNextStartElement())
+		readElement(xsr, ctx);
+
+	if (xsr.hasError())
 	{
 		if (lastError)
-			*lastError = QObject::tr("%1\nline: %2, column: %3").arg(errorString).arg(errorLine).arg(errorColumn);
+			*lastError = QObject::tr("%1\nline: %2, column: %3").arg(xsr.errorString()).arg(xsr.lineNumber()).arg(xsr.columnNumber());
 
+		graph.clear();
 		return false;
 	}
 
-	// try to parse
-	graph.clear();
+	resolveUnknownKeys(ctx);
 
-	QDomNodeList tree = doc.elementsByTagName("graph");
-	if (tree.count())
-	{
-		m_edgeType = tree.at(0).toElement().attribute("edgedefault", "undirected");
-	}
+	if (m_edgeType.isEmpty())
+		m_edgeType = "undirected";
+
+	// done
+	return true;
+}
 
-	ClassKeyAttrMap cka;
 
-	QDomNodeList keys = doc.elementsByTagName("key");
-	for (int i = 0; i < keys.count(); ++i)
+void CFormatGraphML::readElement(QXmlStreamReader &xsr, ReadContext &ctx) const
+{
+	const auto name = xsr.name();
+
+	if (name == QLatin1String("key"))
 	{
-		readAttrKey(i, keys.at(i), graph, cka);
+		readAttrKey(xsr, ctx);
 	}
-
-	QDomNodeList nodes = doc.elementsByTagName("node");
-	for (int i = 0; i < nodes.count(); ++i)
+	else if (name == QLatin1String("node"))
+	{
+		readNode(xsr, ctx);
+	}
+	else if (name == QLatin1String("edge"))
 	{
-		readNode(i, nodes.at(i), graph, cka["node"]);
+		readEdge(xsr, ctx);
 	}
+	else if (name == QLatin1String("graph"))
+	{
+		// the first graph defines the edges
+		if (m_edgeType.isEmpty())
+		{
+			m_edgeType = xsr.attributes().value(QLatin1String("edgedefault")).toString();
+			if (m_edgeType.isEmpty())
+				m_edgeType = "undirected";
+		}
 
-	QDomNodeList edges = doc.elementsByTagName("edge");
-	for (int i = 0; i < edges.count(); ++i)
+		readContent(xsr, ctx);
+	}
+	else
 	{
-		readEdge(i, edges.at(i), graph, cka["edge"]);
+		// graphml root & unknown extensions: look inside
+		readContent(xsr, ctx);
 	}
+}
 
-	// done
-	return true;
+
+void CFormatGraphML::readContent(QXmlStreamReader &xsr, ReadContext &ctx) const
+{
+	while (xsr.readNextStartElement())
+		readElement(xsr, ctx);
 }
 
 
-bool CFormatGraphML::readAttrKey(int /*index*/, const QDomNode& domNode, Graph& graph, ClassKeyAttrMap& cka) const
+bool CFormatGraphML::readAttrKey(QXmlStreamReader &xsr, ReadContext &ctx) const
 {
-	QDomElement elem = domNode.toElement();
+	auto attrs = xsr.attributes();
 
-	auto childElem = elem.elementsByTagName("default");
-	QString defaultValue;
-	if (childElem.size())
-		defaultValue = childElem.at(0).toElement().text();
+	QString keyId = attrs.value(QLatin1String("id")).toString();
+	QString attrId = attrs.value(QLatin1String("attr.id")).toString();
+	QString attrName = attrs.value(QLatin1String("attr.name")).toString();
 
-	QString keyId = elem.attribute("id", "");
-	QString attrId = elem.attribute("attr.id", "");
-	QString attrName = elem.attribute("attr.name", "");
+	QString classId = attrs.value(QLatin1String("for")).toString();
+	QString valueType = attrs.value(QLatin1String("attr.type")).toString();
 
-	QString classId = elem.attribute("for", "");
-	QString valueType = elem.attribute("attr.type", "");
+	QString defaultValue;
+	while (xsr.readNextStartElement())
+	{
+		if (xsr.name() == QLatin1String("default"))
+			defaultValue = xsr.readElementText(QXmlStreamReader::IncludeChildElements);
+		else
+			xsr.skipCurrentElement();
+	}
 
 	if (keyId.isEmpty())
 		keyId = attrId.isEmpty() ? attrName : attrId;
@@ -302,115 +331,167 @@ bool CFormatGraphML::readAttrKey(int /*index*/, const QDomNode& domNode, Graph&
 
 	QByteArray attrClassId = classId.toLower().toLatin1();
 	AttributeInfos& attrInfos =
-		(attrClassId == "node") ? graph.nodeAttrs :
-		(attrClassId == "edge") ? graph.edgeAttrs :
-		graph.graphAttrs;
+		(attrClassId == "node") ? ctx.graph.nodeAttrs :
+		(attrClassId == "edge") ? ctx.graph.edgeAttrs :
+		ctx.graph.graphAttrs;
 
 	attrInfos[attr.id] = attr;
 
 	if (attrClassId == "graph") attrClassId = "";
 
-	cka[attrClassId][keyId.toLatin1()] = attr.id;
+	ctx.cka[attrClassId][keyId.toLatin1()] = attr.id;
 
 	return true;
 }
 
 
-bool CFormatGraphML::readNode(int /*index*/, const QDomNode &domNode, Graph& graph, const KeyAttrMap& nodeKeys) const
+QByteArray CFormatGraphML::readDataKey(QXmlStreamReader &xsr, ReadContext &ctx, const QByteArray &classId) const
 {
-	QDomElement elem = domNode.toElement();
+	QByteArray keyId = xsr.attributes().value(QLatin1String("key")).toLatin1();
+
+	const KeyAttrMap& keys = ctx.cka[classId];
+	auto it = keys.constFind(keyId);
+	if (it != keys.constEnd())
+		return it.value();
+
+	// warning: no key registered (yet)
+	if (!keyId.isEmpty())
+		ctx.unknownKeys << keyId;
+
+	return keyId;
+}
+
+
+bool CFormatGraphML::readNode(QXmlStreamReader &xsr, ReadContext &ctx) const
+{
+	// keep the document order with nested graphs
+	int index = ctx.graph.nodes.size();
+	ctx.graph.nodes.append(Node());
 
 	Node node;
 
 	// common attrs
-	auto id = elem.attribute("id", "").toLatin1();
-	node.id = id;
+	node.id = xsr.attributes().value(QLatin1String("id")).toLatin1();
 
-	QDomNodeList data = elem.elementsByTagName("data");
-	for (int i = 0; i < data.count(); ++i)
+	while (xsr.readNextStartElement())
 	{
-		QDomNode dm = data.at(i);
-		QDomElement de = dm.toElement();
+		const auto name = xsr.name();
 
-		QByteArray keyId = de.attribute("key", "").toLatin1();
-		QByteArray attrId = nodeKeys.contains(keyId) ? 
-			nodeKeys[keyId] : 
-			keyId;				// warning: no key registered
+		if (name == QLatin1String("data"))
+		{
+			QByteArray attrId = readDataKey(xsr, ctx, "node");
+			QVariant value = xsr.readElementText(QXmlStreamReader::IncludeChildElements);
 
-		if (attrId.isEmpty())	// error should be here
-			continue;
+			if (attrId.isEmpty())	// error should be here
+				continue;
 
-		QVariant value = de.text();
-		node.attrs[attrId] = value;
+			node.attrs[attrId] = value;
 
-		// import SocNetV coordinates as well
-		if (attrId == "x_coordinate")
-			node.attrs["x"] = value.toDouble() * 1000;
+			// import SocNetV coordinates as well
+			if (attrId == "x_coordinate")
+				node.attrs["x"] = value.toDouble() * 1000;
+			else
+			if (attrId == "y_coordinate")
+				node.attrs["y"] = value.toDouble() * 1000;
+		}
+		else if (name == QLatin1String("port"))
+		{
+			auto attrs = xsr.attributes();
+
+			QString portName = attrs.value(QLatin1String("name")).toString();
+			if (portName.size())
+			{
+				NodePort port;
+				port.name = portName;
+				port.color = QColor(attrs.value(QLatin1String("color")).toString());
+				port.anchor = attrs.value(QLatin1String("anchor")).toInt();
+				port.x = attrs.value(QLatin1String("x")).toFloat();
+				port.y = attrs.value(QLatin1String("y")).toFloat();
+				node.ports[portName] = port;
+			}
+
+			// nested ports are not supported
+			xsr.skipCurrentElement();
+		}
 		else
-		if (attrId == "y_coordinate")
-			node.attrs["y"] = value.toDouble() * 1000;
-	}
-
-	// ports
-	QDomNodeList portNodes = elem.elementsByTagName("port");
-	for (int i = 0; i < portNodes.count(); ++i)
-	{
-		QDomNode dm = portNodes.at(i);
-		QDomElement de = dm.toElement();
-
-		QString portName = de.attribute("name", "");
-		if (portName.isEmpty())
-			continue;
-
-		NodePort port;
-		port.name = portName;
-		port.color = de.attribute("color");
-		port.anchor = de.attribute("anchor").toInt();
-		port.x = de.attribute("x").toFloat();
-		port.y = de.attribute("y").toFloat();
-		node.ports[portName] = port;
+		{
+			// nested graph etc.
+			readElement(xsr, ctx);
+		}
 	}
 
-	graph.nodes.append(node);
+	ctx.graph.nodes[index] = node;
 
 	return true;
 }
 
 
-bool CFormatGraphML::readEdge(int /*index*/, const QDomNode &domNode, Graph& graph, const KeyAttrMap& edgeKeys) const
+bool CFormatGraphML::readEdge(QXmlStreamReader &xsr, ReadContext &ctx) const
 {
-	QDomElement elem = domNode.toElement();
-	
+	auto attrs = xsr.attributes();
+
 	Edge edge;
-	edge.startNodeId = elem.attribute("source", "").toLatin1();
-	edge.startPortId = elem.attribute("sourceport", "").toLatin1();
-	edge.endNodeId = elem.attribute("target", "").toLatin1();
-	edge.endPortId = elem.attribute("targetport", "").toLatin1();
+	edge.startNodeId = attrs.value(QLatin1String("source")).toLatin1();
+	edge.startPortId = attrs.value(QLatin1String("sourceport")).toLatin1();
+	edge.endNodeId = attrs.value(QLatin1String("target")).toLatin1();
+	edge.endPortId = attrs.value(QLatin1String("targetport")).toLatin1();
 
 	// common attrs
-	QString id = elem.attribute("id", "");
-	edge.id = id.toLatin1();
+	edge.id = attrs.value(QLatin1String("id")).toLatin1();
 
-	QDomNodeList data = elem.elementsByTagName("data");
-	for (int i = 0; i < data.count(); ++i)
+	while (xsr.readNextStartElement())
 	{
-		QDomNode dm = data.at(i);
-		QDomElement de = dm.toElement();
-
-		QByteArray keyId = de.attribute("key", "").toLatin1();
-		QByteArray attrId = edgeKeys.contains(keyId) ?
-			edgeKeys[keyId] :
-			keyId;				// warning: no key registered
+		if (xsr.name() == QLatin1String("data"))
+		{
+			QByteArray attrId = readDataKey(xsr, ctx, "edge");
+			QString value = xsr.readElementText(QXmlStreamReader::IncludeChildElements);
 
-		if (attrId.isEmpty())	// error should be here
-			continue;
+			if (attrId.isEmpty())	// error should be here
+				continue;
 
-		edge.attrs[attrId] = de.text();
+			edge.attrs[attrId] = value;
+		}
+		else
+		{
+			readElement(xsr, ctx);
+		}
 	}
 
-	graph.edges.append(edge);
+	ctx.graph.edges.append(edge);
 
 	return true;
 }
 
 
+void CFormatGraphML::resolveUnknownKeys(ReadContext &ctx) const
+{
+	// keys declared after the data using them: rename the attributes
+	if (ctx.unknownKeys.isEmpty())
+		return;
+
+	const KeyAttrMap& nodeKeys = ctx.cka["node"];
+	const KeyAttrMap& edgeKeys = ctx.cka["edge"];
+
+	for (const auto& keyId : ctx.unknownKeys)
+	{
+		QByteArray nodeAttrId = nodeKeys.value(keyId);
+		if (nodeAttrId.size() && nodeAttrId != keyId)
+		{
+			for (auto& node : ctx.graph.nodes)
+			{
+				if (node.attrs.contains(keyId))
+					node.attrs[nodeAttrId] = node.attrs.take(keyId);
+			}
+		}
+
+		QByteArray edgeAttrId = edgeKeys.value(keyId);
+		if (edgeAttrId.size() && edgeAttrId != keyId)
+		{
+			for (auto& edge : ctx.graph.edges)
+			{
+				if (edge.attrs.contains(keyId))
+					edge.attrs[edgeAttrId] = edge.attrs.take(keyId);
+			}
+		}
+	}
+}
@@ -9,10 +9,11 @@ It can be used freely, maintaining the information above.
 
 #pragma once
 
-#include <QtXml/QDomDocument>
 #include <QMap>
+#include <QSet>
 #include <QByteArray>
 #include <QVariant>
+#include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
 #include <qvgeio/CGraphBase.h>
@@ -28,9 +29,23 @@ private:
 	typedef QMap<QByteArray, QByteArray> KeyAttrMap;		// key:attrId
 	typedef QMap<QByteArray, KeyAttrMap> ClassKeyAttrMap;	// class <> (key:attrId)
 
-	bool readAttrKey(int index, const QDomNode &domNode, Graph& graph, ClassKeyAttrMap& cka) const;
-	bool readNode(int index, const QDomNode &domNode, Graph& graph, const KeyAttrMap& nodeKeys) const;
-	bool readEdge(int index, const QDomNode &domNode, Graph& graph, const KeyAttrMap& edgeKeys) const;
+	// single pass reading: every method consumes the current element
+	struct ReadContext
+	{
+		Graph &graph;
+		ClassKeyAttrMap cka;
+		QSet<QByteArray> unknownKeys;	// used before declared
+
+		ReadContext(Graph &g): graph(g) {}
+	};
+
+	void readElement(QXmlStreamReader &xsr, ReadContext &ctx) const;
+	void readContent(QXmlStreamReader &xsr, ReadContext &ctx) const;
+	bool readAttrKey(QXmlStreamReader &xsr, ReadContext &ctx) const;
+	bool readNode(QXmlStreamReader &xsr, ReadContext &ctx) const;
+	bool readEdge(QXmlStreamReader &xsr, ReadContext &ctx) const;
+	QByteArray readDataKey(QXmlStreamReader &xsr, ReadContext &ctx, const QByteArray &classId) const;
+	void resolveUnknownKeys(ReadContext &ctx) const;
 
 	void writeAttributes(QXmlStreamWriter &xsw, const AttributeInfos &attrs, const QByteArray &classId) const;
 	void writeAttribute(QXmlStreamWriter &xsw, const QString &keyId, const QVariant &value) const;
@@ -0,0 +1,171 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2022 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+// Measures the load throughput of the qvgeio readers.
+// Usage: qvgeiobench [-n <repeats>] <file.graphml|file.gexf|file.dot> ...
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+
+#include <qvgeio/CGraphBase.h>
+#include <qvgeio/CFormatGraphML.h>
+#include <qvgeio/CFormatGEXF.h>
+#include <qvgeio/CFormatDOT.h>
+
+#include <functional>
+
+
+typedef std::function<bool(const QString&, Graph&, QString*)> LoadFunc;
+
+
+static QTextStream& out()
+{
+	static QTextStream ts(stdout);
+	return ts;
+}
+
+
+// runs the loader `repeats` times and returns the best time in ms, or -1 on error
+
+static qint64 measure(const LoadFunc &load, const QString &fileName, int repeats, Graph &g)
+{
+	qint64 best = -1;
+
+	for (int i = 0; i < repeats; ++i)
+	{
+		g.clear();
+
+		QString lastError;
+		QElapsedTimer timer;
+		timer.start();
+
+		if (!load(fileName, g, &lastError))
+		{
+			out() << fileName << ": " << lastError << endl;
+			return -1;
+		}
+
+		qint64 elapsed = timer.nsecsElapsed() / 1000;
+		if (best < 0 || elapsed < best)
+			best = elapsed;
+	}
+
+	return qMax(best, qint64(1));
+}
+
+
+static void report(const QString &title, qint64 fileSize, qint64 usecs, const Graph &g)
+{
+	double mbs = (double(fileSize) / (1024.0 * 1024.0)) / (double(usecs) / 1000000.0);
+
+	out() << "  " << title << ": "
+		<< QString::number(usecs / 1000.0, 'f', 2) << " ms, "
+		<< QString::number(mbs, 'f', 2) << " MB/s, "
+		<< g.nodes.size() << " nodes, "
+		<< g.edges.size() << " edges" << endl;
+}
+
+
+static bool benchFile(const QString &fileName, int repeats)
+{
+	QFileInfo fi(fileName);
+	if (!fi.isFile())
+	{
+		out() << fileName << ": file not found" << endl;
+		return false;
+	}
+
+	QString suffix = fi.suffix().toLower();
+	out() << fileName << " (" << fi.size() << " bytes, best of " << repeats << ")" << endl;
+
+	Graph g;
+	qint64 usecs = -1;
+
+	if (suffix == "graphml" || suffix == "xml")
+	{
+		CFormatGraphML format;
+		usecs = measure([&](const QString &f, Graph &gr, QString *err) { return format.load(f, gr, err); }, fileName, repeats, g);
+		if (usecs > 0)
+			report("GraphML", fi.size(), usecs, g);
+	}
+	else
+	if (suffix == "gexf")
+	{
+		CFormatGEXF format;
+		usecs = measure([&](const QString &f, Graph &gr, QString *err) { return format.load(f, gr, err); }, fileName, repeats, g);
+		if (usecs > 0)
+			report("GEXF", fi.size(), usecs, g);
+	}
+	else
+	if (suffix == "dot" || suffix == "gv")
+	{
+		CFormatDOT format;
+		usecs = measure([&](const QString &f, Graph &gr, QString *err) { return format.load(f, gr, err); }, fileName, repeats, g);
+		if (usecs > 0)
+			report("DOT", fi.size(), usecs, g);
+
+#ifdef USE_BOOST
+		// compare against the Boost.Graph based reader
+		Graph gb;
+		qint64 usecsBoost = measure([&](const QString &f, Graph &gr, QString *err) { return format.loadBoost(f, gr, err); }, fileName, repeats, gb);
+		if (usecsBoost > 0)
+		{
+			report("DOT (Boost)", fi.size(), usecsBoost, gb);
+
+			if (usecs > 0)
+				out() << "  speedup: " << QString::number(double(usecsBoost) / double(usecs), 'f', 2) << "x" << endl;
+		}
+#endif
+	}
+	else
+	{
+		out() << "  unsupported format: " << suffix << endl;
+		return false;
+	}
+
+	return usecs > 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+
+	QStringList args = a.arguments();
+	args.removeFirst();
+
+	int repeats = 1;
+	QStringList files;
+
+	for (int i = 0; i < args.size(); ++i)
+	{
+		if (args[i] == "-n" && i + 1 < args.size())
+			repeats = qMax(1, args[++i].toInt());
+		else
+			files << args[i];
+	}
+
+	if (files.isEmpty())
+	{
+		out() << "Usage: qvgeiobench [-n <repeats>] <file.graphml|file.gexf|file.dot> ..." << endl;
+		return 1;
+	}
+
+	int failed = 0;
+	for (const QString &fileName : files)
+	{
+		if (!benchFile(fileName, repeats))
+			failed++;
+	}
+
+	return failed ? 2 : 0;
+}
@@ -0,0 +1,51 @@
+# This file is a part of
+# QVGE - Qt Visual Graph Editor
+#
+# (c) 2016-2022 Ars L. Masiuk (ars.masiuk@gmail.com)
+#
+# It can be used freely, maintaining the information above.
+
+
+TEMPLATE = app
+TARGET = qvgeiobench
+
+
+# common config
+CONFIG += console c++14
+CONFIG -= app_bundle
+QT += core gui xml
+
+
+# compiler stuff
+win32-msvc*{
+    QMAKE_CXXFLAGS += /MP
+}
+
+gcc{
+    QMAKE_CXXFLAGS += -Wno-unused-variable -Wno-unused-parameter
+}
+
+
+# input
+SOURCES += $$files($$PWD/*.cpp)
+
+INCLUDEPATH += $$PWD/..
+
+
+# includes & libs
+CONFIG(debug, debug|release){
+	DESTDIR = $$OUT_PWD/../bin.debug
+	LIBS += -L$$OUT_PWD/../lib.debug
+}
+else{
+	DESTDIR = $$OUT_PWD/../bin
+	LIBS += -L$$OUT_PWD/../lib
+}
+
+LIBS += -lqvgeio
+
+
+USE_BOOST{
+	LIBS += -L$$BOOST_LIB_PATH -l$$BOOST_LIB_NAME
+	INCLUDEPATH += $$BOOST_INCLUDE_PATH
+}
@@ -243,10 +243,8 @@ bool CImportExportUIController::loadFromFile(const QString &format, const QStrin
 					return true;
 			}
 #endif
-			// try to load via boost
-#ifdef USE_BOOST
+			// native parser
 			return (CFileSerializerDOT().load(fileName, scene, lastError));
-#endif
 		}
 
 		if (format == "plain" || format == "txt")
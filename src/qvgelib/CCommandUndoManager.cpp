@@ -0,0 +1,632 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+
+#include "CCommandUndoManager.h"
+#include "CEditorScene.h"
+#include "CItem.h"
+#include "CNode.h"
+#include "CEdge.h"
+
+#include <QDataStream>
+
+
+CCommandUndoManager::CCommandUndoManager(CEditorScene & scene)
+	: m_scene(&scene)
+{
+}
+
+
+void CCommandUndoManager::reset()
+{
+	m_initialized = false;
+	m_replaying = false;
+
+	m_itemToKey.clear();
+	m_keyToItem.clear();
+	m_snapshots.clear();
+	m_sceneState.clear();
+
+	clearPending();
+
+	m_undoStack.clear();
+	m_redoStack.clear();
+}
+
+
+void CCommandUndoManager::addState()
+{
+	// 1st store: take the initial state
+	if (!m_initialized)
+	{
+		initialize();
+		return;
+	}
+
+	commit();
+}
+
+
+void CCommandUndoManager::revertState()
+{
+	if (m_initialized)
+		revertPending();
+}
+
+
+void CCommandUndoManager::undo()
+{
+	if (!availableUndoCount())
+		return;
+
+	// uncommitted changes are dropped
+	revertPending();
+
+	Transaction t = m_undoStack.takeLast();
+
+	m_replaying = true;
+
+	createItems(t.removed);
+
+	for (int i = t.commands.size() - 1; i >= 0; --i)
+		applyCommand(t.commands.at(i), false);
+
+	QList<quint64> toDelete;
+	for (const auto& snap : t.added)
+		toDelete << snap.key;
+	deleteItems(toDelete);
+
+	m_replaying = false;
+
+	refreshSnapshots(t.commands);
+	m_sceneState = m_scene->storeSceneState();
+
+	m_redoStack << t;
+}
+
+
+void CCommandUndoManager::redo()
+{
+	if (!availableRedoCount())
+		return;
+
+	revertPending();
+
+	Transaction t = m_redoStack.takeLast();
+
+	m_replaying = true;
+
+	createItems(t.added);
+
+	for (const auto& cmd : t.commands)
+		applyCommand(cmd, true);
+
+	QList<quint64> toDelete;
+	for (const auto& snap : t.removed)
+		toDelete << snap.key;
+	deleteItems(toDelete);
+
+	m_replaying = false;
+
+	refreshSnapshots(t.commands);
+	m_sceneState = m_scene->storeSceneState();
+
+	m_undoStack << t;
+}
+
+
+int CCommandUndoManager::availableUndoCount() const
+{
+	return m_undoStack.size();
+}
+
+
+int CCommandUndoManager::availableRedoCount() const
+{
+	return m_redoStack.size();
+}
+
+
+// change tracking
+
+bool CCommandUndoManager::isTrackingChanges() const
+{
+	return m_initialized && !m_replaying;
+}
+
+
+void CCommandUndoManager::onItemAdded(CItem* item)
+{
+	// replayed items are registered before being added
+	if (!m_initialized || m_replaying || m_itemToKey.contains(item))
+		return;
+
+	quint64 key = m_nextKey++;
+	m_itemToKey[item] = key;
+	m_keyToItem[key] = item;
+
+	m_pendingAdded << key;
+}
+
+
+void CCommandUndoManager::onItemRemoved(CItem* item)
+{
+	if (!m_initialized)
+		return;
+
+	quint64 key = m_itemToKey.take(item);
+	if (!key)
+		return;
+
+	m_keyToItem.remove(key);
+
+	if (m_replaying)
+	{
+		m_snapshots.remove(key);
+		return;
+	}
+
+	// created & removed within the same transaction: forget it
+	if (m_pendingAdded.remove(key))
+		m_pendingDead << key;
+	else
+		m_pendingRemoved << key;
+}
+
+
+void CCommandUndoManager::onItemAttributeChanged(CItem* item, const QByteArray& attrId, const QVariant& oldValue, const QVariant& newValue)
+{
+	if (!isTrackingChanges())
+		return;
+
+	quint64 key = keyOf(item);
+	if (!key)
+		return;
+
+	Command cmd;
+	cmd.type = CT_Attribute;
+	cmd.itemKey = key;
+	cmd.id = attrId;
+	cmd.oldValue = oldValue;
+	cmd.newValue = newValue;
+
+	addCommand({ CT_Attribute, key, QByteArray(), attrId }, cmd);
+}
+
+
+void CCommandUndoManager::onItemMoved(CItem* item, const QPointF& oldPos, const QPointF& newPos)
+{
+	if (!isTrackingChanges())
+		return;
+
+	quint64 key = keyOf(item);
+	if (!key)
+		return;
+
+	Command cmd;
+	cmd.type = CT_Move;
+	cmd.itemKey = key;
+	cmd.oldValue = oldPos;
+	cmd.newValue = newPos;
+
+	addCommand({ CT_Move, key, QByteArray(), QByteArray() }, cmd);
+}
+
+
+void CCommandUndoManager::onEdgeRelinked(CEdge* edge, CNode* oldFirst, const QByteArray& oldFirstPort, CNode* oldLast, const QByteArray& oldLastPort)
+{
+	if (!isTrackingChanges())
+		return;
+
+	quint64 key = keyOf(edge);
+	if (!key)
+		return;
+
+	Command cmd;
+	cmd.type = CT_Relink;
+	cmd.itemKey = key;
+	cmd.oldEnds.firstKey = keyOf(oldFirst);
+	cmd.oldEnds.firstPort = oldFirstPort;
+	cmd.oldEnds.lastKey = keyOf(oldLast);
+	cmd.oldEnds.lastPort = oldLastPort;
+	cmd.newEnds.firstKey = keyOf(edge->firstNode());
+	cmd.newEnds.firstPort = edge->firstPortId();
+	cmd.newEnds.lastKey = keyOf(edge->lastNode());
+	cmd.newEnds.lastPort = edge->lastPortId();
+
+	addCommand({ CT_Relink, key, QByteArray(), QByteArray() }, cmd);
+}
+
+
+void CCommandUndoManager::onNodePortsChanged(CNode* node)
+{
+	if (!isTrackingChanges())
+		return;
+
+	// the ports are compared with the snapshot on commit
+	if (quint64 key = keyOf(node))
+		m_pendingPorts << key;
+}
+
+
+void CCommandUndoManager::onClassAttributeChanged(const QByteArray& classId, const QByteArray& attrId, const CAttribute* oldAttr, const CAttribute* newAttr)
+{
+	if (!isTrackingChanges())
+		return;
+
+	Command cmd;
+	cmd.type = CT_ClassAttribute;
+	cmd.classId = classId;
+	cmd.id = attrId;
+	if (oldAttr)
+		cmd.oldAttr = *oldAttr;
+	if (newAttr)
+		cmd.newAttr = *newAttr;
+
+	addCommand({ CT_ClassAttribute, 0, classId, attrId }, cmd);
+}
+
+
+// internal
+
+void CCommandUndoManager::initialize()
+{
+	reset();
+
+	QList<CItem*> allItems;
+
+	for (auto item : m_scene->items())
+	{
+		if (auto citem = dynamic_cast<CItem*>(item))
+		{
+			quint64 key = m_nextKey++;
+			m_itemToKey[citem] = key;
+			m_keyToItem[key] = citem;
+			allItems << citem;
+		}
+	}
+
+	// edges need keys of their nodes, so snapshot after all the keys are known
+	for (auto citem : allItems)
+	{
+		quint64 key = m_itemToKey[citem];
+		m_snapshots[key] = takeSnapshot(key, citem);
+	}
+
+	m_sceneState = m_scene->storeSceneState();
+
+	m_initialized = true;
+}
+
+
+void CCommandUndoManager::commit()
+{
+	Transaction t;
+
+	// commands on the items which are created or removed are covered by snapshots
+	for (const auto& cmd : m_pending)
+	{
+		if (cmd.itemKey)
+		{
+			if (m_pendingAdded.contains(cmd.itemKey) || m_pendingRemoved.contains(cmd.itemKey) || m_pendingDead.contains(cmd.itemKey))
+				continue;
+
+			if (!m_keyToItem.contains(cmd.itemKey))
+				continue;
+		}
+
+		// skip no-op changes
+		if ((cmd.type == CT_Attribute || cmd.type == CT_Move) && cmd.oldValue == cmd.newValue)
+			continue;
+
+		t.commands << cmd;
+	}
+
+	// ports
+	for (quint64 key : m_pendingPorts)
+	{
+		if (m_pendingAdded.contains(key) || !m_snapshots.contains(key))
+			continue;
+
+		CNode *node = dynamic_cast<CNode*>(itemOf(key));
+		if (!node)
+			continue;
+
+		QByteArray ports = node->storePorts();
+		if (ports == m_snapshots[key].ports)
+			continue;
+
+		Command cmd;
+		cmd.type = CT_Ports;
+		cmd.itemKey = key;
+		cmd.oldValue = m_snapshots[key].ports;
+		cmd.newValue = ports;
+		t.commands << cmd;
+	}
+
+	// scene options
+	QByteArray sceneState = m_scene->storeSceneState();
+	if (sceneState != m_sceneState)
+	{
+		Command cmd;
+		cmd.type = CT_SceneState;
+		cmd.oldValue = m_sceneState;
+		cmd.newValue = sceneState;
+		t.commands << cmd;
+
+		m_sceneState = sceneState;
+	}
+
+	// removed items keep their last committed state
+	for (quint64 key : m_pendingRemoved)
+	{
+		if (m_snapshots.contains(key))
+			t.removed << m_snapshots.take(key);
+	}
+
+	// created items are stored as they are now
+	for (quint64 key : m_pendingAdded)
+	{
+		if (CItem *item = itemOf(key))
+		{
+			ItemSnapshot snap = takeSnapshot(key, item);
+			m_snapshots[key] = snap;
+			t.added << snap;
+		}
+	}
+
+	refreshSnapshots(t.commands);
+
+	clearPending();
+
+	if (t.isEmpty())
+		return;
+
+	m_undoStack << t;
+	m_redoStack.clear();
+}
+
+
+void CCommandUndoManager::revertPending()
+{
+	if (m_pending.isEmpty() && m_pendingAdded.isEmpty() && m_pendingRemoved.isEmpty() && m_pendingPorts.isEmpty())
+	{
+		// options could be changed without any notification
+		if (m_scene->storeSceneState() != m_sceneState)
+		{
+			m_replaying = true;
+			m_scene->restoreSceneState(m_sceneState);
+			m_replaying = false;
+		}
+
+		return;
+	}
+
+	m_replaying = true;
+
+	QList<ItemSnapshot> removed;
+	for (quint64 key : m_pendingRemoved)
+	{
+		if (m_snapshots.contains(key))
+			removed << m_snapshots[key];
+	}
+	createItems(removed);
+
+	for (int i = m_pending.size() - 1; i >= 0; --i)
+		applyCommand(m_pending.at(i), false);
+
+	for (quint64 key : m_pendingPorts)
+	{
+		CNode *node = dynamic_cast<CNode*>(itemOf(key));
+		if (node && m_snapshots.contains(key))
+			node->restorePorts(m_snapshots[key].ports);
+	}
+
+	deleteItems(m_pendingAdded.toList());
+
+	m_scene->restoreSceneState(m_sceneState);
+
+	m_replaying = false;
+
+	clearPending();
+}
+
+
+void CCommandUndoManager::clearPending()
+{
+	m_pendingAdded.clear();
+	m_pendingRemoved.clear();
+	m_pendingDead.clear();
+	m_pendingPorts.clear();
+	m_pending.clear();
+	m_pendingIndex.clear();
+}
+
+
+quint64 CCommandUndoManager::keyOf(const CItem* item) const
+{
+	return item ? m_itemToKey.value(item, 0) : 0;
+}
+
+
+CItem* CCommandUndoManager::itemOf(quint64 key) const
+{
+	return m_keyToItem.value(key, nullptr);
+}
+
+
+CCommandUndoManager::ItemSnapshot CCommandUndoManager::takeSnapshot(quint64 key, CItem* item) const
+{
+	ItemSnapshot snap;
+	snap.key = key;
+	snap.typeId = item->typeId();
+
+	QDataStream ds(&snap.data, QIODevice::WriteOnly);
+	item->storeTo(ds, CEditorScene::storageVersion());
+
+	if (CEdge *edge = dynamic_cast<CEdge*>(item))
+	{
+		snap.firstPtr = quint64(edge->firstNode());
+		snap.lastPtr = quint64(edge->lastNode());
+		snap.firstKey = keyOf(edge->firstNode());
+		snap.lastKey = keyOf(edge->lastNode());
+	}
+	else if (CNode *node = dynamic_cast<CNode*>(item))
+	{
+		snap.ports = node->storePorts();
+	}
+
+	return snap;
+}
+
+
+void CCommandUndoManager::addCommand(const CommandKey& cmdKey, const Command& cmd)
+{
+	// merge with the pending one: keep the first old & the last new value
+	auto it = m_pendingIndex.find(cmdKey);
+	if (it != m_pendingIndex.end())
+	{
+		Command& pending = m_pending[*it];
+		pending.newValue = cmd.newValue;
+		pending.newEnds = cmd.newEnds;
+		pending.newAttr = cmd.newAttr;
+		return;
+	}
+
+	m_pendingIndex[cmdKey] = m_pending.size();
+	m_pending << cmd;
+}
+
+
+// replay
+
+void CCommandUndoManager::createItems(const QList<ItemSnapshot>& snapshots)
+{
+	QList<CItem*> created;
+	QList<const ItemSnapshot*> createdSnapshots;
+
+	for (const auto& snap : snapshots)
+	{
+		CItem *item = m_scene->createItemOfType(snap.typeId);
+		if (!item)
+			continue;
+
+		QDataStream ds(snap.data);
+		if (!item->restoreFrom(ds, CEditorScene::storageVersion()))
+		{
+			delete item;
+			continue;
+		}
+
+		m_itemToKey[item] = snap.key;
+		m_keyToItem[snap.key] = item;
+		m_snapshots[snap.key] = snap;
+
+		created << item;
+		createdSnapshots << &snap;
+	}
+
+	// link & add: all the nodes are existing now
+	CItem::beginRestore();
+
+	for (int i = 0; i < created.size(); ++i)
+	{
+		const ItemSnapshot *snap = createdSnapshots.at(i);
+
+		// pointers could be reused over time, so map them per item
+		CItem::CItemLinkMap idToItem;
+		if (snap->firstPtr)
+			idToItem[snap->firstPtr] = itemOf(snap->firstKey);
+		if (snap->lastPtr)
+			idToItem[snap->lastPtr] = itemOf(snap->lastKey);
+
+		created.at(i)->linkAfterRestore(idToItem);
+
+		m_scene->addItem(dynamic_cast<QGraphicsItem*>(created.at(i)));
+	}
+
+	CItem::endRestore();
+
+	for (CItem *item : created)
+		item->onItemRestored();
+}
+
+
+void CCommandUndoManager::deleteItems(const QList<quint64>& keys)
+{
+	// edges can be deleted together with their nodes, so look up each time
+	for (quint64 key : keys)
+	{
+		if (CItem *item = itemOf(key))
+			delete dynamic_cast<QGraphicsItem*>(item);
+	}
+}
+
+
+void CCommandUndoManager::applyCommand(const Command& cmd, bool forward)
+{
+	const QVariant& value = forward ? cmd.newValue : cmd.oldValue;
+
+	switch (cmd.type)
+	{
+	case CT_Attribute:
+		if (CItem *item = itemOf(cmd.itemKey))
+		{
+			if (value.isValid())
+				item->setAttribute(cmd.id, value);
+			else
+				item->removeAttribute(cmd.id);
+		}
+		break;
+
+	case CT_Move:
+		if (CItem *item = itemOf(cmd.itemKey))
+			item->getSceneItem()->setPos(value.toPointF());
+		break;
+
+	case CT_Relink:
+		if (CEdge *edge = dynamic_cast<CEdge*>(itemOf(cmd.itemKey)))
+		{
+			const EdgeEnds& ends = forward ? cmd.newEnds : cmd.oldEnds;
+			edge->setFirstNode(dynamic_cast<CNode*>(itemOf(ends.firstKey)), ends.firstPort);
+			edge->setLastNode(dynamic_cast<CNode*>(itemOf(ends.lastKey)), ends.lastPort);
+		}
+		break;
+
+	case CT_Ports:
+		if (CNode *node = dynamic_cast<CNode*>(itemOf(cmd.itemKey)))
+			node->restorePorts(value.toByteArray());
+		break;
+
+	case CT_ClassAttribute:
+		m_scene->restoreClassAttribute(cmd.classId, cmd.id, forward ? cmd.newAttr : cmd.oldAttr);
+		break;
+
+	case CT_SceneState:
+		m_scene->restoreSceneState(value.toByteArray());
+		break;
+	}
+}
+
+
+void CCommandUndoManager::refreshSnapshots(const QList<Command>& commands)
+{
+	QSet<quint64> touched;
+	for (const auto& cmd : commands)
+	{
+		if (cmd.itemKey)
+			touched << cmd.itemKey;
+	}
+
+	for (quint64 key : touched)
+	{
+		if (CItem *item = itemOf(key))
+			m_snapshots[key] = takeSnapshot(key, item);
+	}
+}
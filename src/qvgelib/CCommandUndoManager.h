@@ -0,0 +1,161 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include "IUndoManager.h"
+#include "CAttribute.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QVariant>
+#include <QtCore/QList>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+
+class CEditorScene;
+
+
+// Undo manager recording incremental commands instead of whole-scene snapshots.
+// Every item gets a stable key which survives deletion & re-creation by undo/redo.
+// Only the touched items are serialized when a state is committed.
+
+class CCommandUndoManager : public IUndoManager
+{
+public:
+	CCommandUndoManager(CEditorScene &scene);
+
+	// reimp
+	virtual void reset();
+	virtual void addState();
+	virtual void revertState();
+	virtual void undo();
+	virtual void redo();
+	virtual int availableUndoCount() const;
+	virtual int availableRedoCount() const;
+
+	virtual bool isTrackingChanges() const;
+
+	virtual void onItemAdded(CItem* item);
+	virtual void onItemRemoved(CItem* item);
+	virtual void onItemAttributeChanged(CItem* item, const QByteArray& attrId, const QVariant& oldValue, const QVariant& newValue);
+	virtual void onItemMoved(CItem* item, const QPointF& oldPos, const QPointF& newPos);
+	virtual void onEdgeRelinked(CEdge* edge, CNode* oldFirst, const QByteArray& oldFirstPort, CNode* oldLast, const QByteArray& oldLastPort);
+	virtual void onNodePortsChanged(CNode* node);
+	virtual void onClassAttributeChanged(const QByteArray& classId, const QByteArray& attrId, const CAttribute* oldAttr, const CAttribute* newAttr);
+
+private:
+	enum CommandType
+	{
+		CT_Attribute,
+		CT_Move,
+		CT_Relink,
+		CT_Ports,
+		CT_ClassAttribute,
+		CT_SceneState
+	};
+
+	struct EdgeEnds
+	{
+		quint64 firstKey = 0, lastKey = 0;
+		QByteArray firstPort, lastPort;
+	};
+
+	struct Command
+	{
+		CommandType type = CT_Attribute;
+		quint64 itemKey = 0;
+		QByteArray classId;
+		QByteArray id;
+
+		// attribute value, position, ports or scene state
+		QVariant oldValue, newValue;
+
+		// CT_Relink
+		EdgeEnds oldEnds, newEnds;
+
+		// CT_ClassAttribute (empty id = not existing)
+		CAttribute oldAttr, newAttr;
+	};
+
+	struct CommandKey
+	{
+		int type;
+		quint64 itemKey;
+		QByteArray classId;
+		QByteArray id;
+
+		bool operator == (const CommandKey& other) const
+		{
+			return type == other.type && itemKey == other.itemKey && classId == other.classId && id == other.id;
+		}
+
+		friend uint qHash(const CommandKey& key, uint seed = 0)
+		{
+			return ::qHash(key.itemKey, seed) ^ ::qHash(key.id, seed) ^ ::qHash(key.classId, seed) ^ uint(key.type);
+		}
+	};
+
+	struct ItemSnapshot
+	{
+		quint64 key = 0;
+		QByteArray typeId;
+		QByteArray data;
+
+		// edges: stored node pointers & their keys
+		quint64 firstPtr = 0, lastPtr = 0;
+		quint64 firstKey = 0, lastKey = 0;
+
+		// nodes: ports
+		QByteArray ports;
+	};
+
+	struct Transaction
+	{
+		QList<ItemSnapshot> added, removed;
+		QList<Command> commands;
+
+		bool isEmpty() const { return added.isEmpty() && removed.isEmpty() && commands.isEmpty(); }
+	};
+
+	void initialize();
+	void commit();
+	void revertPending();
+	void clearPending();
+
+	quint64 keyOf(const CItem* item) const;
+	CItem* itemOf(quint64 key) const;
+	ItemSnapshot takeSnapshot(quint64 key, CItem* item) const;
+	void addCommand(const CommandKey& cmdKey, const Command& cmd);
+
+	void createItems(const QList<ItemSnapshot>& snapshots);
+	void deleteItems(const QList<quint64>& keys);
+	void applyCommand(const Command& cmd, bool forward);
+	void refreshSnapshots(const QList<Command>& commands);
+
+	CEditorScene *m_scene;
+
+	bool m_initialized = false;
+	bool m_replaying = false;
+
+	// item keys
+	quint64 m_nextKey = 1;
+	QHash<const CItem*, quint64> m_itemToKey;
+	QHash<quint64, CItem*> m_keyToItem;
+
+	// last committed state of the items & the scene
+	QHash<quint64, ItemSnapshot> m_snapshots;
+	QByteArray m_sceneState;
+
+	// changes since the last commit
+	QSet<quint64> m_pendingAdded, m_pendingRemoved, m_pendingDead, m_pendingPorts;
+	QList<Command> m_pending;
+	QHash<CommandKey, int> m_pendingIndex;
+
+	QList<Transaction> m_undoStack, m_redoStack;
+};
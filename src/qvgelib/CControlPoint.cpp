@@ -11,6 +11,7 @@ It can be used freely, maintaining the information above.
 
 #include "CControlPoint.h"
 #include "CItem.h"
+#include "CEditorScene.h"
 
 
 CControlPoint::CControlPoint(CItem *parent) : 
@@ -22,6 +23,32 @@ CControlPoint::CControlPoint(CItem *parent) :
 	setRect(-4, -4, 8, 8);
 	setBrush(Qt::black);
 	setPen(QPen(Qt::gray, 1));
+
+	// the parent could be in a scene already
+	updateSceneAttachment();
+}
+
+
+CControlPoint::~CControlPoint()
+{
+	if (m_attachedScene)
+		m_attachedScene->onControlPointRemoved(this);
+}
+
+
+void CControlPoint::updateSceneAttachment()
+{
+	auto editorScene = dynamic_cast<CEditorScene*>(scene());
+	if (editorScene == m_attachedScene)
+		return;
+
+	if (m_attachedScene)
+		m_attachedScene->onControlPointRemoved(this);
+
+	m_attachedScene = editorScene;
+
+	if (m_attachedScene)
+		m_attachedScene->onControlPointAdded(this);
 }
 
 
@@ -46,10 +73,27 @@ QVariant CControlPoint::itemChange(QGraphicsItem::GraphicsItemChange change, con
 		return value;
 	}
 
+	if (change == ItemSceneHasChanged)
+	{
+		updateSceneAttachment();
+
+		return value;
+	}
+
 	return Shape::itemChange(change, value);
 }
 
 
+void CControlPoint::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+	// the points belong to the selected edge: hidden with the selection
+	if (m_attachedScene && m_attachedScene->isSelectionHidden())
+		return;
+
+	Shape::paint(painter, option, widget);
+}
+
+
 // menu
 
 void CControlPoint::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
@@ -13,6 +13,7 @@ It can be used freely, maintaining the information above.
 
 
 class CItem;
+class CEditorScene;
 
 
 class CControlPoint : public QObject, public QGraphicsRectItem
@@ -23,7 +24,7 @@ public:
 	typedef QGraphicsRectItem Shape;
 
 	explicit CControlPoint(CItem *parent);
-	virtual ~CControlPoint() {}
+	virtual ~CControlPoint();
 
 protected Q_SLOTS:
 	void onActionDelete();
@@ -32,7 +33,11 @@ protected:
 	// reimp 
 	virtual QVariant itemChange(QGraphicsItem::GraphicsItemChange change, const QVariant &value);
 	virtual void contextMenuEvent(QGraphicsSceneContextMenuEvent *event);
+	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = Q_NULLPTR);
+
+	void updateSceneAttachment();
 
 	CItem *m_parentItem;
+	CEditorScene *m_attachedScene = nullptr;
 };
 
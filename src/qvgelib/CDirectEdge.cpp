@@ -60,6 +60,16 @@ void CDirectEdge::paint(QPainter *painter, const QStyleOptionGraphicsItem *optio
 	if (m_shapeCachePath.isEmpty())
 		return;
 
+	// cached pen
+	checkStyle();
+
+	// zoomed out: no curves & arrows
+	if (option->levelOfDetailFromTransform(painter->worldTransform()) < LOD_Simplified)
+	{
+		drawSimplified(painter, option, QPolygonF() << line().p1() << line().p2());
+		return;
+	}
+
 	// selection
 	drawSelection(painter, option);
 
@@ -68,40 +78,11 @@ void CDirectEdge::paint(QPainter *painter, const QStyleOptionGraphicsItem *optio
 
     painter->setClipRect(boundingRect());
 
-	auto len = line().length();
-	bool isArrow = (len > ARROW_SIZE * 2);
-
-	bool isDirect = (!isCircled() && (m_bendFactor == 0));
-	if (isDirect)	// straight line
-	{
-		painter->setBrush(Qt::NoBrush);
-		painter->drawPath(m_shapeCachePath);
-
-        // arrows
-		if (isArrow && m_itemFlags & CF_Start_Arrow)
-			drawArrow(painter, option, true, QLineF(line().p2(), line().p1()));
+	painter->setBrush(Qt::NoBrush);
+	painter->drawPath(m_shapeCachePath);
 
-		if (isArrow && m_itemFlags & CF_End_Arrow)
-			drawArrow(painter, option, false, line());
-	}
-	else // curve
-	{
-		painter->setBrush(Qt::NoBrush);
-		painter->drawPath(m_shapeCachePath);
-
-		// arrows
-        if (isArrow && m_itemFlags & CF_Start_Arrow)
-        {
-            QLineF arrowLine = calculateArrowLine(m_shapeCachePath, true, QLineF(m_controlPos, line().p1()));
-            drawArrow(painter, option, true, arrowLine);
-        }
-
-        if (isArrow && m_itemFlags & CF_End_Arrow)
-        {
-            QLineF arrowLine = calculateArrowLine(m_shapeCachePath, false, QLineF(m_controlPos, line().p2()));
-            drawArrow(painter, option, false, arrowLine);
-        }
-    }
+	// arrows
+	drawArrows(painter);
 }
 
 
@@ -134,6 +115,25 @@ void CDirectEdge::updateLabelPosition()
 
 // callbacks 
 
+bool CDirectEdge::canPrepareGeometry() const
+{
+	// ports are positioned via scene transforms which are not safe to read concurrently
+	if (!m_firstNode || !m_lastNode || m_firstPortId.size() || m_lastPortId.size())
+		return false;
+
+	// resolve the lazy class attributes here, not in the workers
+	getVisibleWeight();
+
+	return true;
+}
+
+
+void CDirectEdge::prepareGeometry()
+{
+	m_preparedGeometry = calculateGeometry();
+}
+
+
 void CDirectEdge::onParentGeometryChanged()
 {
 	// optimize: no update while restoring
@@ -143,8 +143,49 @@ void CDirectEdge::onParentGeometryChanged()
 	if (!m_firstNode || !m_lastNode)
 		return;
 
+	EdgeGeometry geometry;
+	if (m_preparedGeometry.valid)
+		qSwap(geometry, m_preparedGeometry);
+	else
+		geometry = calculateGeometry();
+
 	prepareGeometryChange();
 
+	setLine(geometry.line);
+	notifyGeometryChanged();
+
+	m_shapeCachePath = geometry.shape;
+	m_controlPos = geometry.controlPos;
+	m_controlPoint = geometry.controlPoint;
+
+	invalidateSelectionShape();
+	setArrowDirections(geometry.startArrow, geometry.endArrow);
+
+	//update();
+
+	// update text label
+	if (getScene() && getScene()->itemLabelsEnabled())
+	{
+		if (m_shapeCachePath.isEmpty())
+		{
+			m_labelItem->hide();
+		}
+		else
+		{
+			m_labelItem->show();
+
+			updateLabelPosition();
+			updateLabelDecoration();
+		}
+	}
+}
+
+
+CDirectEdge::EdgeGeometry CDirectEdge::calculateGeometry() const
+{
+	EdgeGeometry g;
+	g.valid = true;
+
 	// update line position
 	QPointF p1c = m_firstNode->pos();
 	if (m_firstPortId.size() && m_firstNode->getPort(m_firstPortId))
@@ -160,12 +201,10 @@ void CDirectEdge::onParentGeometryChanged()
 	bool intersected = (!p1.isNull()) && (!p2.isNull());
 
 	QLineF l(p1, p2);
-	setLine(l);
+	g.line = l;
 
 
 	// update shape path
-	m_shapeCachePath = QPainterPath();
-
 	double arrowSize = getVisibleWeight() + ARROW_SIZE;
 
 	// circled connection 
@@ -184,18 +223,18 @@ void CDirectEdge::onParentGeometryChanged()
 		QPointF p2 = m_lastNode->getIntersectionPoint(QLineF(p2c, rp), m_lastPortId);
 
 		// up point
-		m_controlPos = (p1c + p2c) / 2 + QPointF(0, -r * 2);
-		m_controlPoint = (lp + rp) / 2;
+		g.controlPos = (p1c + p2c) / 2 + QPointF(0, -r * 2);
+		g.controlPoint = (lp + rp) / 2;
 
 		QLineF l(p1, p2);
-		setLine(l);
+		g.line = l;
 
-		createCurvedPath(true, l, QLineF(p1c, p2c), p1, lp, rp, p2, arrowSize);
+		g.shape = createCurvedPath(true, l, QLineF(p1c, p2c), p1, lp, rp, p2, arrowSize);
 	}
 	else // not circled
 	{
 		// center
-		m_controlPos = (p1c + p2c) / 2;
+		g.controlPos = (p1c + p2c) / 2;
 
 		if (m_bendFactor == 0)
 		{
@@ -210,13 +249,13 @@ void CDirectEdge::onParentGeometryChanged()
 					m_itemFlags & CF_End_Arrow ? arrowSize : 0);
 			}
 
-			m_shapeCachePath.moveTo(l.p1());
-			m_shapeCachePath.lineTo(l.p2());
+			g.shape.moveTo(l.p1());
+			g.shape.lineTo(l.p2());
 
 #if QT_VERSION < 0x050a00
-            m_controlPoint = (line().p1() + line().p2()) / 2;
+            g.controlPoint = (g.line.p1() + g.line.p2()) / 2;
 #else
-			m_controlPoint = line().center();
+			g.controlPoint = g.line.center();
 #endif
 			auto fullLen = QLineF(p1c, p2c).length();
 			//qDebug() << len << fullLen;
@@ -224,12 +263,12 @@ void CDirectEdge::onParentGeometryChanged()
 			// if no intersection or len == fullLen : drop the shape
 			if (!intersected || qAbs(len - fullLen) < 5)
 			{
-				m_shapeCachePath = QPainterPath();
+				g.shape = QPainterPath();
 			}
 		}
 		else
 		{
-			QPointF t1 = m_controlPos;
+			QPointF t1 = g.controlPos;
 			float posFactor = qAbs(m_bendFactor);
 
 			bool bendDirection = (quint64(m_firstNode) > quint64(m_lastNode));
@@ -240,48 +279,50 @@ void CDirectEdge::onParentGeometryChanged()
 			f1.setAngle(bendDirection ? f1.angle() + 90 : f1.angle() - 90);
 			f1.setLength(f1.length() * 0.2 * posFactor);
 
-			m_controlPos = f1.p2();
-			m_controlPoint = m_controlPos - (t1 - m_controlPos) * 0.33;
+			g.controlPos = f1.p2();
+			g.controlPoint = g.controlPos - (t1 - g.controlPos) * 0.33;
 
-			createCurvedPath(intersected, l, QLineF(p1c, p2c), p1, m_controlPoint, m_controlPoint, p2, arrowSize);
+			g.shape = createCurvedPath(intersected, l, QLineF(p1c, p2c), p1, g.controlPoint, g.controlPoint, p2, arrowSize);
 		}
 	}
 
-	// rasterise the line stroke
-	QPainterPathStroker stroker;
-	stroker.setWidth(6);
-	m_selectionShapePath = stroker.createStroke(m_shapeCachePath);
-
-	//update();
-
-	// update text label
-	if (getScene() && getScene()->itemLabelsEnabled())
+	// arrows: only the shown ends, updateArrowFlags() reschedules the geometry
+	if (!g.shape.isEmpty() && g.line.length() > ARROW_SIZE * 2)
 	{
-		if (m_shapeCachePath.isEmpty())
+		bool startArrow = (m_itemFlags & CF_Start_Arrow);
+		bool endArrow = (m_itemFlags & CF_End_Arrow);
+
+		if (isCircled() || m_bendFactor != 0)
 		{
-			m_labelItem->hide();
+			// arc length lookups
+			if (startArrow)
+				g.startArrow = calculateArrowLine(g.shape, true, QLineF(g.controlPos, g.line.p1()));
+			if (endArrow)
+				g.endArrow = calculateArrowLine(g.shape, false, QLineF(g.controlPos, g.line.p2()));
 		}
 		else
 		{
-			m_labelItem->show();
-
-			updateLabelPosition();
-			updateLabelDecoration();
+			if (startArrow)
+				g.startArrow = QLineF(g.line.p2(), g.line.p1());
+			if (endArrow)
+				g.endArrow = g.line;
 		}
 	}
+
+	return g;
 }
 
 
-void CDirectEdge::createCurvedPath(bool intersected,
+QPainterPath CDirectEdge::createCurvedPath(bool intersected,
 	const QLineF& shortLine, const QLineF& fullLine,
 	const QPointF& p1, const QPointF& lp, const QPointF& rp, const QPointF& p2,
-	double arrowSize)
+	double arrowSize) const
 {
 	auto len = shortLine.length();
 	auto fullLen = fullLine.length();
 	//qDebug() << len << fullLen;
 
-	m_shapeCachePath = QPainterPath();
+	QPainterPath path;
 
 	// if no intersection or len == fullLen : drop the shape
 	if (!intersected || qAbs(len - fullLen) < 5)
@@ -289,8 +330,8 @@ void CDirectEdge::createCurvedPath(bool intersected,
 	}
 	else
 	{
-		m_shapeCachePath.moveTo(p1);
-		m_shapeCachePath.cubicTo(lp, rp, p2);
+		path.moveTo(p1);
+		path.cubicTo(lp, rp, p2);
 
 		// check arrows
 		if (m_itemFlags & CF_Mutual_Arrows)
@@ -299,20 +340,22 @@ void CDirectEdge::createCurvedPath(bool intersected,
 
 			if (m_itemFlags & CF_Start_Arrow)
 			{
-				qreal arrowStart = m_shapeCachePath.percentAtLength(arrowSize);
-				newP1 = m_shapeCachePath.pointAtPercent(arrowStart);
+				qreal arrowStart = path.percentAtLength(arrowSize);
+				newP1 = path.pointAtPercent(arrowStart);
 			}
 
 			if (m_itemFlags & CF_End_Arrow)
 			{
-				qreal arrowStart = m_shapeCachePath.percentAtLength(m_shapeCachePath.length() - arrowSize);
-				newP2 = m_shapeCachePath.pointAtPercent(arrowStart);
+				qreal arrowStart = path.percentAtLength(path.length() - arrowSize);
+				newP2 = path.pointAtPercent(arrowStart);
 			}
 
-			m_shapeCachePath = QPainterPath();
-			m_shapeCachePath.moveTo(newP1);
-			m_shapeCachePath.cubicTo(lp, rp, newP2);
+			path = QPainterPath();
+			path.moveTo(newP1);
+			path.cubicTo(lp, rp, newP2);
 		}
 	}
+
+	return path;
 }
 
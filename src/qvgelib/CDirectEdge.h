@@ -40,6 +40,10 @@ public:
 		bool changeSize, bool changePos) override 
 	{}
 
+	// geometry scheduling
+	virtual bool canPrepareGeometry() const;
+	virtual void prepareGeometry();
+
 protected:
 	// reimp
 	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = Q_NULLPTR);
@@ -49,10 +53,24 @@ protected:
 	virtual void onParentGeometryChanged();
 
 private:
-	void createCurvedPath(bool intersected, 
+	struct EdgeGeometry
+	{
+		bool valid = false;
+		QLineF line;
+		QPainterPath shape;
+		QPointF controlPos, controlPoint;
+		QLineF startArrow, endArrow;
+	};
+
+	// reads the nodes only, no side effects
+	EdgeGeometry calculateGeometry() const;
+
+	QPainterPath createCurvedPath(bool intersected, 
 		const QLineF& shortLine, const QLineF& fullLine,
 		const QPointF& p1, const QPointF& lp, const QPointF& rp, const QPointF& p2,
-		double arrowSize);
+		double arrowSize) const;
+
+	EdgeGeometry m_preparedGeometry;
 
 protected:
 	int m_bendFactor;
@@ -9,6 +9,7 @@ It can be used freely, maintaining the information above.
 
 #include "CEdge.h"
 #include "CNode.h"
+#include "CNodeEditorScene.h"
 #include "CEditorSceneDefines.h"
 
 #include <QPen>
@@ -43,7 +44,7 @@ CEdge::CEdge(QGraphicsItem *parent): Shape(parent)
 	//setCacheMode(DeviceCoordinateCache);
 
 	// label
-	m_labelItem = new QGraphicsSimpleTextItem(this);
+	m_labelItem = new CItemLabel(this);
 	m_labelItem->setFlags(0);
 	m_labelItem->setCacheMode(DeviceCoordinateCache);
 	m_labelItem->setPen(Qt::NoPen);
@@ -81,7 +82,12 @@ bool CEdge::setAttribute(const QByteArray& attrId, const QVariant& v)
 
 	bool res = Super::setAttribute(attrId, v);
 
-	if (res) update();
+	if (res)
+	{
+		update();
+		notifyGeometryChanged();
+	}
+
 	return res;
 }
 
@@ -95,7 +101,12 @@ bool CEdge::removeAttribute(const QByteArray& attrId)
 		updateArrowFlags(getAttribute(attr_edge_direction).toString());
 	}
 
-	if (res) update();
+	if (res)
+	{
+		update();
+		notifyGeometryChanged();
+	}
+
 	return res;
 }
 
@@ -107,11 +118,32 @@ void CEdge::updateCachedItems()
 	Super::updateCachedItems();
 
 	updateArrowFlags(getAttribute(attr_edge_direction).toString());
+
+	// the pen could be changed
+	notifyGeometryChanged();
+}
+
+
+void CEdge::updateStyle()
+{
+	Super::updateStyle();
+
+	double weight = getVisibleWeight();
+
+    Qt::PenStyle penStyle = (Qt::PenStyle) CUtils::textToPenStyle(
+                getAttribute(attr_style).toString(), Qt::SolidLine);
+
+	QColor color = getAttribute(attr_color).value<QColor>();
+
+	m_style.pen = QPen(color, weight, penStyle, Qt::FlatCap, Qt::RoundJoin);
+	m_arrowPen = QPen(color, weight, Qt::SolidLine, Qt::SquareCap, Qt::MiterJoin);
 }
 
 
 void CEdge::updateArrowFlags(const QString& direction)
 {
+	int oldArrows = m_itemFlags & CF_Mutual_Arrows;
+
 	if (direction == "directed")
 	{
 		setItemFlag(CF_End_Arrow);
@@ -125,6 +157,10 @@ void CEdge::updateArrowFlags(const QString& direction)
 	{
 		resetItemFlag(CF_Mutual_Arrows);
 	}
+
+	// the arrow directions are calculated with the geometry
+	if ((m_itemFlags & CF_Mutual_Arrows) != oldArrows && m_firstNode && m_lastNode)
+		scheduleGeometry();
 }
 
 
@@ -136,18 +172,131 @@ QRectF CEdge::boundingRect() const
 }
 
 
-void CEdge::setupPainter(QPainter *painter, const QStyleOptionGraphicsItem* /*option*/, QWidget* /*widget*/)
+// hit tests
+
+// half of the selection stroke width
+static const qreal HIT_DISTANCE = 3;
+
+
+static bool isNearSegment(const QPointF& p, const QPointF& a, const QPointF& b, qreal dist)
 {
-	double weight = getVisibleWeight();
+	QPointF ab = b - a;
+	QPointF ap = p - a;
+	qreal len2 = QPointF::dotProduct(ab, ab);
 
-    Qt::PenStyle penStyle = (Qt::PenStyle) CUtils::textToPenStyle(
-                getAttribute(attr_style).toString(), Qt::SolidLine);
+	qreal t = (len2 > 0) ? qBound(0.0, QPointF::dotProduct(ap, ab) / len2, 1.0) : 0.0;
+	QPointF d = ap - ab * t;
 
-	// get color (to optimize!)
-	QColor color = getAttribute(attr_color).value<QColor>();
+	return QPointF::dotProduct(d, d) <= dist * dist;
+}
+
+
+static bool isNearCubic(const QPointF& p, const QPointF& p0, const QPointF& c1, const QPointF& c2, const QPointF& p3, qreal dist, int depth = 0)
+{
+	// the curve lies within its control polygon
+	qreal left = qMin(qMin(p0.x(), c1.x()), qMin(c2.x(), p3.x())) - dist;
+	qreal right = qMax(qMax(p0.x(), c1.x()), qMax(c2.x(), p3.x())) + dist;
+	qreal top = qMin(qMin(p0.y(), c1.y()), qMin(c2.y(), p3.y())) - dist;
+	qreal bottom = qMax(qMax(p0.y(), c1.y()), qMax(c2.y(), p3.y())) + dist;
+
+	if (p.x() < left || p.x() > right || p.y() < top || p.y() > bottom)
+		return false;
+
+	// flat enough: the chord is the curve
+	QLineF chord(p0, p3);
+	qreal chordLen = chord.length();
+	qreal flatness = 0;
+	if (chordLen > 0)
+	{
+		QPointF n(-chord.dy() / chordLen, chord.dx() / chordLen);
+		flatness = qMax(qAbs(QPointF::dotProduct(c1 - p0, n)), qAbs(QPointF::dotProduct(c2 - p0, n)));
+	}
+	else
+		flatness = qMax(QLineF(p0, c1).length(), QLineF(p0, c2).length());
+
+	if (flatness < 0.25 || depth >= 16)
+		return isNearSegment(p, p0, p3, dist);
+
+	// de Casteljau split at the middle
+	QPointF p01 = (p0 + c1) / 2, p12 = (c1 + c2) / 2, p23 = (c2 + p3) / 2;
+	QPointF p012 = (p01 + p12) / 2, p123 = (p12 + p23) / 2;
+	QPointF mid = (p012 + p123) / 2;
+
+	return isNearCubic(p, p0, p01, p012, mid, dist, depth + 1) || isNearCubic(p, mid, p123, p23, p3, dist, depth + 1);
+}
+
+
+QPainterPath CEdge::shape() const
+{
+	// stroking is expensive: only when really asked (collisions, rubber band)
+	if (m_selectionShapeDirty)
+	{
+		m_selectionShapeDirty = false;
+
+		QPainterPathStroker stroker;
+		stroker.setWidth(HIT_DISTANCE * 2);
+		m_selectionShapePath = stroker.createStroke(m_shapeCachePath);
+	}
+
+	return m_selectionShapePath;
+}
 
-	QPen p(color, weight, penStyle, Qt::FlatCap, Qt::RoundJoin);
-	painter->setPen(p);
+
+bool CEdge::contains(const QPointF& point) const
+{
+	// analytic test against the lines & curves, no stroking
+	QPointF last;
+
+	for (int i = 0; i < m_shapeCachePath.elementCount(); ++i)
+	{
+		const QPainterPath::Element& e = m_shapeCachePath.elementAt(i);
+
+		switch (e.type)
+		{
+		case QPainterPath::MoveToElement:
+			last = e;
+			break;
+
+		case QPainterPath::LineToElement:
+			if (isNearSegment(point, last, e, HIT_DISTANCE))
+				return true;
+			last = e;
+			break;
+
+		case QPainterPath::CurveToElement:
+			if (i + 2 < m_shapeCachePath.elementCount())
+			{
+				QPointF c1 = e;
+				QPointF c2 = m_shapeCachePath.elementAt(i + 1);
+				QPointF p3 = m_shapeCachePath.elementAt(i + 2);
+
+				if (isNearCubic(point, last, c1, c2, p3, HIT_DISTANCE))
+					return true;
+
+				last = p3;
+			}
+			i += 2;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	return false;
+}
+
+
+void CEdge::invalidateSelectionShape()
+{
+	m_selectionShapePath = QPainterPath();
+	m_selectionShapeDirty = true;
+}
+
+
+void CEdge::setupPainter(QPainter *painter, const QStyleOptionGraphicsItem* /*option*/, QWidget* /*widget*/)
+{
+	painter->setPen(getStyle().pen);
 
 	painter->setOpacity(1.0);
 }
@@ -155,10 +304,11 @@ void CEdge::setupPainter(QPainter *painter, const QStyleOptionGraphicsItem* /*op
 
 void CEdge::drawSelection(QPainter *painter, const QStyleOptionGraphicsItem *option) const
 {
-	bool isSelected = (option->state & QStyle::State_Selected);
+	bool isSelected = isSelectionPainted(option);
 	if (isSelected)
 	{
-		double weight = getVisibleWeight();
+		// style is up to date here: paint() calls checkStyle() first
+		double weight = m_style.pen.widthF();
 		QPen p(QColor(Qt::darkCyan), weight * 2 + 2, Qt::SolidLine, Qt::FlatCap, Qt::RoundJoin);
 		painter->setOpacity(0.3);
 		painter->setPen(p);
@@ -168,6 +318,21 @@ void CEdge::drawSelection(QPainter *painter, const QStyleOptionGraphicsItem *opt
 }
 
 
+void CEdge::drawSimplified(QPainter *painter, const QStyleOptionGraphicsItem *option, const QPolygonF &polyline) const
+{
+	bool isSelected = isSelectionPainted(option);
+
+	// already drawn by the scene: only the selected/hovered edges on top
+	if (m_batchedDrawing && !isSelected && !(option->state & QStyle::State_MouseOver))
+		return;
+
+	painter->setRenderHint(QPainter::Antialiasing, false);
+	painter->setOpacity(1.0);
+	painter->setPen(QPen(isSelected ? QColor(Qt::darkCyan) : m_style.pen.color(), 0));
+	painter->drawPolyline(polyline);
+}
+
+
 double CEdge::getWeight() const
 {
 	bool ok = false;
@@ -218,40 +383,60 @@ QLineF CEdge::calculateArrowLine(const QPainterPath &path, bool first, const QLi
 }
 
 
-void CEdge::drawArrow(QPainter* painter, const QStyleOptionGraphicsItem* /*option*/, bool first, const QLineF& direction) const
+void CEdge::setArrowDirections(const QLineF& start, const QLineF& end)
 {
-	if (first && m_firstNode)
-	{
-		drawArrow(painter, 0, direction);
-	}
-	else if (!first && m_lastNode)
-	{
-		drawArrow(painter, 0, direction);
-	}
+	m_arrowDirections[0] = start;
+	m_arrowDirections[1] = end;
+
+	m_arrowHeadsWidth = -1;
 }
 
 
-void CEdge::drawArrow(QPainter* painter, qreal /*shift*/, const QLineF& direction) const
+static QPolygonF createArrowHead(const QLineF& direction, qreal arrowSize, qreal penWidth)
 {
-	static QPolygonF arrowHead;
-	if (arrowHead.isEmpty())
-		arrowHead << QPointF(0, 0) << QPointF(-ARROW_SIZE/2, ARROW_SIZE) << QPointF(ARROW_SIZE/2, ARROW_SIZE) << QPointF(0, 0);
+	if (direction.isNull())
+		return QPolygonF();
 
-	QPen oldPen = painter->pen();
-	painter->save();
-
-	painter->setPen(QPen(oldPen.color(), oldPen.widthF(), Qt::SolidLine, Qt::SquareCap, Qt::MiterJoin));
-	painter->setBrush(oldPen.color());
+	QPolygonF arrowHead;
+	arrowHead << QPointF(0, 0) << QPointF(-arrowSize / 2, arrowSize) << QPointF(arrowSize / 2, arrowSize) << QPointF(0, 0);
 
+	// tip at the end of the direction, shifted back by the pen
 	static QLineF hl(0, 0, 0, 100);
 	qreal a = direction.angleTo(hl);
 
-	painter->translate(direction.p2());
-	painter->rotate(180 + a);
-	painter->translate(QPointF(0, oldPen.widthF()));
-	painter->drawPolygon(arrowHead);
+	QTransform t;
+	t.translate(direction.p2().x(), direction.p2().y());
+	t.rotate(180 + a);
+	t.translate(0, penWidth);
+
+	return t.map(arrowHead);
+}
+
 
-	painter->restore();
+void CEdge::drawArrows(QPainter *painter)
+{
+	bool start = (m_itemFlags & CF_Start_Arrow) && !m_arrowDirections[0].isNull();
+	bool end = (m_itemFlags & CF_End_Arrow) && !m_arrowDirections[1].isNull();
+	if (!start && !end)
+		return;
+
+	// style is up to date here: paint() calls checkStyle() first
+	qreal penWidth = m_style.pen.widthF();
+	if (penWidth != m_arrowHeadsWidth)
+	{
+		m_arrowHeadsWidth = penWidth;
+		m_arrowHeads[0] = createArrowHead(m_arrowDirections[0], ARROW_SIZE, penWidth);
+		m_arrowHeads[1] = createArrowHead(m_arrowDirections[1], ARROW_SIZE, penWidth);
+	}
+
+	painter->setPen(m_arrowPen);
+	painter->setBrush(m_arrowPen.color());
+
+	if (start)
+		painter->drawPolygon(m_arrowHeads[0]);
+
+	if (end)
+		painter->drawPolygon(m_arrowHeads[1]);
 }
 
 
@@ -312,11 +497,29 @@ bool CEdge::linkAfterPaste(const CItemLinkMap& idToItem)
 }
 
 
+QList<CItem*> CEdge::getLinkedItems() const
+{
+	QList<CItem*> nodes;
+
+	if (m_firstNode)
+		nodes << m_firstNode;
+
+	if (m_lastNode && m_lastNode != m_firstNode)
+		nodes << m_lastNode;
+
+	return nodes;
+}
+
+
 // impl
 
 void CEdge::setFirstNode(CNode *node, const QByteArray& portId)
 {
-    if (m_firstNode && m_firstNode != node)
+	CNode *oldFirst = m_firstNode;
+	QByteArray oldFirstPort = m_firstPortId;
+
+	// keep the connection if the node is still attached by the other end
+    if (m_firstNode && m_firstNode != node && m_firstNode != m_lastNode)
         m_firstNode->onConnectionDetach(this);
 
     m_firstNode = node;
@@ -327,13 +530,18 @@ void CEdge::setFirstNode(CNode *node, const QByteArray& portId)
 	if (m_firstNode)
         m_firstNode->onConnectionAttach(this);
 
+	notifyRelinked(oldFirst, oldFirstPort, m_lastNode, m_lastPortId);
+
 	onParentGeometryChanged();
 }
 
 
 void CEdge::setLastNode(CNode *node, const QByteArray& portId)
 {
-    if (m_lastNode && m_lastNode != node)
+	CNode *oldLast = m_lastNode;
+	QByteArray oldLastPort = m_lastPortId;
+
+    if (m_lastNode && m_lastNode != node && m_lastNode != m_firstNode)
         m_lastNode->onConnectionDetach(this);
 
     m_lastNode = node;
@@ -344,10 +552,32 @@ void CEdge::setLastNode(CNode *node, const QByteArray& portId)
     if (m_lastNode)
         m_lastNode->onConnectionAttach(this);
 
+	notifyRelinked(m_firstNode, m_firstPortId, oldLast, oldLastPort);
+
 	onParentGeometryChanged();
 }
 
 
+void CEdge::notifyRelinked(CNode *oldFirst, const QByteArray& oldFirstPort, CNode *oldLast, const QByteArray& oldLastPort)
+{
+	if (oldFirst == m_firstNode && oldFirstPort == m_firstPortId && oldLast == m_lastNode && oldLastPort == m_lastPortId)
+		return;
+
+	if (auto tracker = getChangeTracker())
+		tracker->onEdgeRelinked(this, oldFirst, oldFirstPort, oldLast, oldLastPort);
+
+	if (auto nodeScene = dynamic_cast<CNodeEditorScene*>(m_attachedScene))
+		nodeScene->onEdgeRelinked(this);
+}
+
+
+void CEdge::notifyGeometryChanged()
+{
+	if (m_attachedScene)
+		m_attachedScene->onItemGeometryChanged(this);
+}
+
+
 bool CEdge::reattach(CNode *oldNode, CNode *newNode, const QByteArray& portId)
 {
 	if (newNode && oldNode == newNode && !newNode->allowCircledConnection())
@@ -390,6 +620,8 @@ void CEdge::reverse()
 	qSwap(m_firstNode, m_lastNode);
 	qSwap(m_firstPortId, m_lastPortId);
 
+	notifyRelinked(m_lastNode, m_lastPortId, m_firstNode, m_firstPortId);
+
 	onParentGeometryChanged();
 }
 
@@ -411,7 +643,31 @@ void CEdge::onNodeMoved(CNode *node)
 	Q_ASSERT(node == m_firstNode || node == m_lastNode);
 	Q_ASSERT(node != NULL);
 
+	// coalesce: many nodes may move at once, recompute once per frame
+	scheduleGeometry();
+}
+
+
+void CEdge::updateGeometry()
+{
 	onParentGeometryChanged();
+
+	invalidateLabelLayout();
+}
+
+
+void CEdge::scheduleGeometry()
+{
+	if (!s_duringRestore)
+	{
+		if (auto nodeScene = dynamic_cast<CNodeEditorScene*>(getScene()))
+		{
+			nodeScene->scheduleEdgeGeometry(this);
+			return;
+		}
+	}
+
+	updateGeometry();
 }
 
 
@@ -445,11 +701,16 @@ void CEdge::onNodePortDeleted(CNode *node, const QByteArray& portId)
 
 void CEdge::onNodePortRenamed(CNode *node, const QByteArray& portId, const QByteArray& oldPortId)
 {
+	QByteArray oldFirstPort = m_firstPortId;
+	QByteArray oldLastPort = m_lastPortId;
+
 	if (m_firstNode == node && m_firstPortId == oldPortId)
 		m_firstPortId = portId;
 
 	if (m_lastNode == node && m_lastPortId == oldPortId)
 		m_lastPortId = portId;
+
+	notifyRelinked(m_firstNode, oldFirstPort, m_lastNode, oldLastPort);
 }
 
 
@@ -470,7 +731,12 @@ QVariant CEdge::itemChange(QGraphicsItem::GraphicsItemChange change, const QVari
 		// set default ID
 		setDefaultId();
 
-		onItemRestored();
+		// notify the scene
+		updateSceneAttachment();
+
+		// when restoring, onItemRestored() is called afterwards
+		if (!s_duringRestore)
+			onItemRestored();
 
 		return value;
 	}
@@ -494,6 +760,14 @@ QVariant CEdge::itemChange(QGraphicsItem::GraphicsItemChange change, const QVari
 		return value;
 	}
 
+	if (change == ItemVisibleHasChanged)
+	{
+		// the scene edge layer skips the hidden edges
+		notifyGeometryChanged();
+
+		return value;
+	}
+
 	return value;
 }
 
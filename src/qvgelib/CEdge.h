@@ -64,7 +64,8 @@ public:
 
 	// reimp
 	virtual QRectF boundingRect() const;
-	virtual QPainterPath shape() const { return m_selectionShapePath; }
+	virtual QPainterPath shape() const;
+	virtual bool contains(const QPointF& point) const;
 
 	// attributes
 	virtual bool hasLocalAttribute(const QByteArray& attrId) const;
@@ -76,6 +77,7 @@ public:
 	virtual bool restoreFrom(QDataStream& out, quint64 version64);
 	virtual bool linkAfterRestore(const CItemLinkMap& idToItem);
 	virtual bool linkAfterPaste(const CItemLinkMap& idToItem);
+	virtual QList<CItem*> getLinkedItems() const;
 
     // callbacks
 	virtual void onNodeMoved(CNode *node);
@@ -86,12 +88,24 @@ public:
 	virtual void onParentGeometryChanged() = 0;
 	virtual void onItemRestored();
 
+	// geometry scheduling: canPrepareGeometry() is asked in the main thread, if true then prepareGeometry()
+	// may run in a worker thread; the next updateGeometry() applies the prepared result
+	virtual bool canPrepareGeometry() const		{ return false; }
+	virtual void prepareGeometry()				{}
+	void updateGeometry();
+
+	// drawn by the scene edge layer when zoomed out
+	void setBatchedDrawing(bool on)		{ m_batchedDrawing = on; }
+	bool isBatchedDrawing() const		{ return m_batchedDrawing; }
+	// false when hidden or covered by the nodes: paint() draws nothing then
+	bool hasVisibleGeometry() const		{ return isVisible() && !m_shapeCachePath.isEmpty(); }
+
 protected:
 	/*virtual*/ void setupPainter(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = Q_NULLPTR);
 	/*virtual*/ void drawSelection(QPainter *painter, const QStyleOptionGraphicsItem *option) const;
-	/*virtual*/ void drawArrow(QPainter *painter, const QStyleOptionGraphicsItem *option, bool first, const QLineF &direction) const;
-	/*virtual*/ void drawArrow(QPainter *painter, qreal shift, const QLineF &direction) const;
 	QLineF calculateArrowLine(const QPainterPath &path, bool first, const QLineF &direction) const;
+	// zoomed out: a hairline without arrows
+	void drawSimplified(QPainter *painter, const QStyleOptionGraphicsItem *option, const QPolygonF &polyline) const;
 
 	// reimp
 	virtual QVariant itemChange(QGraphicsItem::GraphicsItemChange change, const QVariant &value);
@@ -99,10 +113,24 @@ protected:
 
 	// cached attributes
 	virtual void updateCachedItems();
+	virtual void updateStyle();
 	virtual void updateArrowFlags(const QString& direction);
 
 	double getVisibleWeight() const;
 
+	void notifyRelinked(CNode *oldFirst, const QByteArray& oldFirstPort, CNode *oldLast, const QByteArray& oldLastPort);
+	void notifyGeometryChanged();
+	// updates the geometry on the next frame (in the node editor) or right now
+	void scheduleGeometry();
+
+	// m_shapeCachePath has been changed: the selection shape is stroked on demand
+	void invalidateSelectionShape();
+
+	// arrow heads: the directions come with the geometry (null line: no arrow), 
+	// the polygons are rebuilt on the pen width change only
+	void setArrowDirections(const QLineF& start, const QLineF& end);
+	void drawArrows(QPainter *painter);
+
 protected:
     CNode *m_firstNode = nullptr;
     quint64 m_tempFirstNodeId = 0;
@@ -112,9 +140,17 @@ protected:
 
 	QByteArray m_firstPortId, m_lastPortId;
 
-	QPainterPath m_selectionShapePath;
+	mutable QPainterPath m_selectionShapePath;
+	mutable bool m_selectionShapeDirty = false;
 	QPainterPath m_shapeCachePath;
 
+	QLineF m_arrowDirections[2];
+	QPolygonF m_arrowHeads[2];
+	qreal m_arrowHeadsWidth = -1;
+	QPen m_arrowPen;
+
+	bool m_batchedDrawing = false;
+
 	const int ARROW_SIZE = 6;
 };
 
@@ -15,6 +15,7 @@ It can be used freely, maintaining the information above.
 #include "CControlPoint.h"
 #include "CSimpleUndoManager.h"
 #include "CDiffUndoManager.h"
+#include "CCommandUndoManager.h"
 #include "ISceneItemFactory.h"
 #include "ISceneMenuController.h"
 
@@ -31,6 +32,12 @@ It can be used freely, maintaining the information above.
 #include <QDebug>
 #include <QElapsedTimer>
 #include <QPixmapCache> 
+#include <QPicture>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
 
 #include <qopengl.h>
 
@@ -39,6 +46,10 @@ const quint64 version64 = 12;	// build
 const char* versionId = "VersionId";
 
 
+// unique over all the scenes, so items can compare versions safely
+quint64 CEditorScene::s_classAttributesVersionCounter = 0;
+
+
 CEditorScene::CEditorScene(QObject *parent): 
 	Super(parent),
     m_doubleClick(false),
@@ -48,7 +59,8 @@ CEditorScene::CEditorScene(QObject *parent):
     m_pimpl(new CEditorScene_p(this)),
     m_infoStatus(-1),
     //m_undoManager(new CSimpleUndoManager(*this)),
-	m_undoManager(new CDiffUndoManager(*this)),
+	//m_undoManager(new CDiffUndoManager(*this)),
+	m_undoManager(new CCommandUndoManager(*this)),
     m_menuTriggerItem(nullptr),
     m_needUpdateItems(true),
 	m_labelsEnabled(true),
@@ -80,6 +92,11 @@ CEditorScene::CEditorScene(QObject *parent):
 CEditorScene::~CEditorScene()
 {
 	disconnect();
+
+	// no change tracking while dying
+	if (m_undoManager)
+		m_undoManager->reset();
+
 	clear();
 
 	delete m_pimpl;
@@ -105,6 +122,8 @@ void CEditorScene::initialize()
 	m_classAttributesVis.clear();
 	m_classAttributesConstrains.clear();
 
+	invalidateClassAttributes();
+
 	// default item attrs
     createClassAttribute(class_item, "label", tr("Label"), "", ATTR_NODEFAULT | ATTR_FIXED, nullptr, true);
 	createClassAttribute(class_item, "label.color", tr("Label Color"), QColor(Qt::black));
@@ -206,6 +225,8 @@ void CEditorScene::copyProperties(const CEditorScene& from)
 	m_classAttributes = from.m_classAttributes;
 	m_classToSuperIds = from.m_classToSuperIds;
 	m_classAttributesVis = from.m_classAttributesVis;
+
+	invalidateClassAttributes();
 }
 
 CEditorScene* CEditorScene::clone()
@@ -274,6 +295,9 @@ void CEditorScene::addUndoState()
 
 	m_inProgress = true;
 
+	// the undo state and the canvas size need the final edge geometry
+	flushPendingGeometry();
+
 	onSceneChanged();
 
 	// canvas size
@@ -326,6 +350,15 @@ void CEditorScene::setInitialState()
 }
 
 
+IUndoManager* CEditorScene::getChangeTracker() const
+{
+	if (m_undoManager && m_undoManager->isTrackingChanges())
+		return m_undoManager;
+
+	return nullptr;
+}
+
+
 int CEditorScene::availableUndoCount() const
 { 
 	return m_undoManager ? m_undoManager->availableUndoCount() : 0; 
@@ -345,8 +378,70 @@ void CEditorScene::checkUndoState()
 }
 
 
+QByteArray CEditorScene::storeSceneState() const
+{
+	QByteArray buffer;
+	QDataStream out(&buffer, QIODevice::WriteOnly);
+
+	out << backgroundBrush();
+	out << m_gridPen;
+	out << m_gridSize;
+	out << m_gridEnabled << m_gridSnap;
+	out << sceneRect();
+	out << m_classToSuperIds;
+	out << m_classAttributesVis;
+
+	return buffer;
+}
+
+
+void CEditorScene::restoreSceneState(const QByteArray& state)
+{
+	QDataStream in(state);
+
+	QBrush brush;
+	in >> brush;
+	setBackgroundBrush(brush);
+
+	in >> m_gridPen;
+	in >> m_gridSize;
+	in >> m_gridEnabled >> m_gridSnap;
+
+	QRectF rect;
+	in >> rect;
+	setSceneRect(rect);
+
+	in >> m_classToSuperIds;
+	in >> m_classAttributesVis;
+
+	invalidateClassAttributes();
+
+	needUpdate();
+}
+
+
+void CEditorScene::restoreClassAttribute(const QByteArray& classId, const QByteArray& attrId, const CAttribute& attr)
+{
+	// empty id: the attribute did not exist
+	if (attr.id.isEmpty())
+		m_classAttributes[classId].remove(attrId);
+	else
+		m_classAttributes[classId][attrId] = attr;
+
+	invalidateClassAttributes();
+
+	invalidateClass(classId);
+}
+
+
 // io
 
+quint64 CEditorScene::storageVersion()
+{
+	return version64;
+}
+
+
 bool CEditorScene::storeTo(QDataStream& out, bool storeOptions) const
 {
     out << versionId << version64;
@@ -354,15 +449,9 @@ bool CEditorScene::storeTo(QDataStream& out, bool storeOptions) const
 	// items
 	QMap<CItem*, uint> sortedMap;
 
-	QList<QGraphicsItem*> allItems = items();
-
-	for (QGraphicsItem* item : allItems)
+	for (CItem* citem : m_itemsRegistry)
 	{
-		CItem* citem = dynamic_cast<CItem*>(item);
-		if (citem)
-		{
-            sortedMap[citem] = quint64(citem);
-		}
+		sortedMap[citem] = quint64(citem);
 	}
 
 	for (CItem* citem : sortedMap.keys())
@@ -376,6 +465,12 @@ bool CEditorScene::storeTo(QDataStream& out, bool storeOptions) const
 	out << QByteArray("_attr_");
 	out << (quint64)0x12345678;
 
+	return storeSettingsTo(out, storeOptions);
+}
+
+
+bool CEditorScene::storeSettingsTo(QDataStream& out, bool storeOptions) const
+{
 	out << m_classAttributes.size();
 	for (auto classAttrsIt = m_classAttributes.constBegin(); classAttrsIt != m_classAttributes.constEnd(); ++classAttrsIt)
 	{
@@ -409,6 +504,28 @@ bool CEditorScene::storeTo(QDataStream& out, bool storeOptions) const
 
 
 bool CEditorScene::restoreFrom(QDataStream& out, bool readOptions)
+{
+	// bulk mode: no signals & index updates while the items are restored
+	bool wasBlocked = blockSignals(true);
+	auto indexMethod = itemIndexMethod();
+	setItemIndexMethod(QGraphicsScene::NoIndex);
+
+	bool ok = restoreItemsFrom(out, readOptions);
+
+	setItemIndexMethod(indexMethod);
+	blockSignals(wasBlocked);
+
+	// once for all the removed items
+	Q_EMIT selectionChanged();
+
+	// the stored scene rect was set while the signals were blocked
+	Q_EMIT sceneRectChanged(sceneRect());
+
+	return ok;
+}
+
+
+bool CEditorScene::restoreItemsFrom(QDataStream& out, bool readOptions)
 {
 	initialize();
 
@@ -441,6 +558,8 @@ bool CEditorScene::restoreFrom(QDataStream& out, bool readOptions)
                 idToItem[ptrId] = item;
 				continue;
 			}
+
+			delete item;
 		}
 
 		// failed: cleanup
@@ -463,7 +582,7 @@ bool CEditorScene::restoreFrom(QDataStream& out, bool readOptions)
 			// failed: cleanup
 			qDeleteAll(idToItem.values());
 
-			clear();
+			removeItems();
 
 			CItem::endRestore();
 
@@ -471,6 +590,38 @@ bool CEditorScene::restoreFrom(QDataStream& out, bool readOptions)
 		}
 	}
 
+	// attributes, options etc.
+	if (!restoreSettingsFrom(out, storedVersion, readOptions))
+	{
+		CItem::endRestore();
+
+		return false;
+	}
+
+	// finish: dependent items (i.e. edges) after the ones they are linked to
+	CItem::endRestore();
+
+	QList<CItem*> dependentItems;
+
+	for (CItem* item : idToItem.values())
+	{
+		if (item->getLinkedItems().size())
+			dependentItems << item;
+		else
+			item->onItemRestored();
+	}
+
+	for (CItem* item : dependentItems)
+	{
+		item->onItemRestored();
+	}
+
+	return true;
+}
+
+
+bool CEditorScene::restoreSettingsFrom(QDataStream& out, quint64 storedVersion, bool readOptions)
+{
 	// attributes
 	if (storedVersion >= 3)
 	{
@@ -497,11 +648,7 @@ bool CEditorScene::restoreFrom(QDataStream& out, bool readOptions)
 					setClassAttribute(classId, attr);
 				}
 				else
-				{
-					CItem::endRestore();
-
 					return false;
-				}
 			}
 		}
 	}
@@ -511,6 +658,8 @@ bool CEditorScene::restoreFrom(QDataStream& out, bool readOptions)
 	{
 		out >> m_classToSuperIds;
 		out >> m_classAttributesVis;
+
+		invalidateClassAttributes();
 	}
 
 	// options
@@ -531,14 +680,6 @@ bool CEditorScene::restoreFrom(QDataStream& out, bool readOptions)
 		setSceneRect(sr);
 	}
 
-	// finish
-	CItem::endRestore();
-
-	for (CItem* item : idToItem.values())
-	{
-		item->onItemRestored();
-	}
-
 	return true;
 }
 
@@ -554,6 +695,8 @@ bool CEditorScene::setItemFactory(CItem *factoryItem, const QByteArray& typeId)
 		QByteArray superClassId = factoryItem->superClassId();
 		m_classToSuperIds[classId] = superClassId;
 
+		invalidateClassAttributes();
+
 		QByteArray id = typeId.isEmpty() ? factoryItem->typeId() : typeId;
 		m_itemFactories[id] = factoryItem;
 		return true;
@@ -599,7 +742,11 @@ CAttribute& CEditorScene::createClassAttribute(
 	CAttributeConstrains* constrains,
 	bool vis) 
 {
-	if (m_classAttributes[classId].contains(attrId))
+	auto tracker = getChangeTracker();
+	bool existed = m_classAttributes[classId].contains(attrId);
+	CAttribute oldAttr = existed ? m_classAttributes[classId][attrId] : CAttribute();
+
+	if (existed)
 	{
 		// just update the value
 		m_classAttributes[classId][attrId].defaultValue = defaultValue;
@@ -614,32 +761,56 @@ CAttribute& CEditorScene::createClassAttribute(
 			setClassAttributeConstrains(classId, attrId, constrains);
 	}
 
+	invalidateClassAttributes();
+
+	if (tracker)
+		tracker->onClassAttributeChanged(classId, attrId, existed ? &oldAttr : nullptr, &m_classAttributes[classId][attrId]);
+
 	return m_classAttributes[classId][attrId];
 }
 
 
 void CEditorScene::setClassAttribute(const QByteArray& classId, const CAttribute& attr, bool vis)
 {
+	auto tracker = getChangeTracker();
+	bool existed = m_classAttributes[classId].contains(attr.id);
+	CAttribute oldAttr = existed ? m_classAttributes[classId][attr.id] : CAttribute();
+
 	// only update value if exists
-	if (m_classAttributes[classId].contains(attr.id))
+	if (existed)
 		m_classAttributes[classId][attr.id].defaultValue = attr.defaultValue;
 	else 
 		// else insert
 		m_classAttributes[classId][attr.id] = attr;
 
+	invalidateClassAttributes();
+
+	if (tracker)
+		tracker->onClassAttributeChanged(classId, attr.id, existed ? &oldAttr : nullptr, &m_classAttributes[classId][attr.id]);
+
 	setClassAttributeVisible(classId, attr.id, vis);
 
-	needUpdate();
+	invalidateClass(classId);
 }
 
 
 void CEditorScene::setClassAttribute(const QByteArray& classId, const QByteArray& attrId, const QVariant& defaultValue)
 {
+	auto tracker = getChangeTracker();
+
 	if (m_classAttributes[classId].contains(attrId))
 	{
+		CAttribute oldAttr = m_classAttributes[classId][attrId];
+
 		// just update the value
 		m_classAttributes[classId][attrId].defaultValue = defaultValue;
-		needUpdate();
+
+		invalidateClassAttributes();
+
+		if (tracker)
+			tracker->onClassAttributeChanged(classId, attrId, &oldAttr, &m_classAttributes[classId][attrId]);
+
+		invalidateClass(classId);
 		return;
 	}
 
@@ -655,15 +826,26 @@ void CEditorScene::setClassAttribute(const QByteArray& classId, const QByteArray
 		auto attr = m_classAttributes[superId][attrId];
 		attr.defaultValue = defaultValue;
 		m_classAttributes[classId][attrId] = attr;
+
+		invalidateClassAttributes();
+
+		if (tracker)
+			tracker->onClassAttributeChanged(classId, attrId, nullptr, &attr);
 			
-		needUpdate();
+		invalidateClass(classId);
 		return;
 	}
 
 	// else create new attribute with name = id
 	CAttribute attr(attrId, attrId, defaultValue);
 	m_classAttributes[classId][attrId] = attr;
-	needUpdate();
+
+	invalidateClassAttributes();
+
+	if (tracker)
+		tracker->onClassAttributeChanged(classId, attrId, nullptr, &attr);
+
+	invalidateClass(classId);
 }
 
 
@@ -673,7 +855,18 @@ bool CEditorScene::removeClassAttribute(const QByteArray& classId, const QByteAr
 	if (it == m_classAttributes.end())
 		return false;
 
-	needUpdate();
+	invalidateClass(classId);
+
+	if (auto tracker = getChangeTracker())
+	{
+		if ((*it).contains(attrId))
+		{
+			CAttribute oldAttr = (*it)[attrId];
+			tracker->onClassAttributeChanged(classId, attrId, &oldAttr, nullptr);
+		}
+	}
+
+	invalidateClassAttributes();
 
 	return (*it).remove(attrId);
 }
@@ -689,11 +882,8 @@ void CEditorScene::setClassAttributeVisible(const QByteArray& classId, const QBy
 	else
 		m_classAttributesVis[classId].remove(attrId);
 
-	// set label update flag
-	m_labelsUpdate = true;
-
-	// schedule update
-	invalidate();
+	// only the labels of this class are affected
+	invalidateClass(classId);
 }
 
 
@@ -725,27 +915,81 @@ void CEditorScene::setVisibleClassAttributes(const QByteArray& classId, const QS
 {
 	m_classAttributesVis[classId] = vis;
 
-	// set label update flag
-	m_labelsUpdate = true;
-
-	// schedule update
-	invalidate();
+	// only the labels of this class are affected
+	invalidateClass(classId);
 }
 
 
 const CAttribute CEditorScene::getClassAttribute(const QByteArray& classId, const QByteArray& attrId, bool inherited) const 
 {
-	CAttribute attr = m_classAttributes[classId][attrId];
-	if (attr.id.size() || !inherited)
-		return attr;
+	if (inherited)
+	{
+		const CAttribute* attr = getResolvedClassAttribute(classId, attrId);
+		return attr ? *attr : CAttribute();
+	}
 
-	// else inherited
-	QByteArray superId = getSuperClassId(classId);
-	if (superId.isEmpty())
-		// fail
+	auto classIt = m_classAttributes.constFind(classId);
+	if (classIt == m_classAttributes.constEnd())
 		return CAttribute();
 
-	return getClassAttribute(superId, attrId, true);
+	return classIt->value(attrId);
+}
+
+
+const CEditorScene::ResolvedAttributes& CEditorScene::getResolvedClassAttributes(const QByteArray& classId) const
+{
+	// drop all the tables if anything has been changed
+	if (m_resolvedAttributesVersion != m_classAttributesVersion)
+	{
+		m_resolvedClassAttributes.clear();
+		m_resolvedAttributesVersion = m_classAttributesVersion;
+	}
+
+	auto it = m_resolvedClassAttributes.find(classId);
+	if (it != m_resolvedClassAttributes.end())
+		return *it;
+
+	// derived attributes override the inherited ones
+	ResolvedAttributes& resolved = m_resolvedClassAttributes[classId];
+
+	QByteArray id = classId;
+	QSet<QByteArray> visited;
+	while (!id.isEmpty() && !visited.contains(id))
+	{
+		visited << id;
+
+		auto classIt = m_classAttributes.constFind(id);
+		if (classIt != m_classAttributes.constEnd())
+		{
+			for (auto attrIt = classIt->constBegin(); attrIt != classIt->constEnd(); ++attrIt)
+			{
+				if (!resolved.contains(attrIt.key()))
+					resolved[attrIt.key()] = attrIt.value();
+			}
+		}
+
+		id = getSuperClassId(id);
+	}
+
+	return resolved;
+}
+
+
+const CAttribute* CEditorScene::getResolvedClassAttribute(const QByteArray& classId, const QByteArray& attrId) const
+{
+	const ResolvedAttributes& resolved = getResolvedClassAttributes(classId);
+
+	auto it = resolved.constFind(attrId);
+	if (it == resolved.constEnd())
+		return nullptr;
+
+	return &(*it);
+}
+
+
+void CEditorScene::invalidateClassAttributes()
+{
+	m_classAttributesVersion = ++s_classAttributesVersionCounter;
 }
 
 
@@ -826,6 +1070,111 @@ void CEditorScene::del()
 }
 
 
+// clipboard data of the copied items: the preview image is rendered on demand
+
+class CSelectionMimeData : public QMimeData
+{
+public:
+	CSelectionMimeData(const CEditorScene& scene): m_scene(const_cast<CEditorScene*>(&scene)) {}
+
+	virtual QStringList formats() const
+	{
+		QStringList list = QMimeData::formats();
+		if (m_scene)
+			list << "application/x-qt-image";
+		return list;
+	}
+
+	virtual bool hasFormat(const QString& mimeType) const
+	{
+		return formats().contains(mimeType);
+	}
+
+protected:
+	virtual QVariant retrieveData(const QString& mimeType, QVariant::Type type) const
+	{
+		if (mimeType == "application/x-qt-image" || mimeType.startsWith("image/"))
+		{
+			if (m_image.isNull() && m_scene)
+				m_image = renderImage();
+
+			return m_image;
+		}
+
+		return QMimeData::retrieveData(mimeType, type);
+	}
+
+private:
+	QImage renderImage() const;
+
+	QPointer<CEditorScene> m_scene;
+	mutable QImage m_image;
+};
+
+
+QImage CSelectionMimeData::renderImage() const
+{
+	// larger selections are scaled down
+	const int maxSide = 4096;
+
+	// paste it to a temp scene & record its painting
+	QScopedPointer<CEditorScene> tempScene(m_scene->createScene());
+	tempScene->copyProperties(*m_scene);
+	tempScene->paste();
+
+	CEditorScene::RenderOptions options;
+	options.cropToContent = true;
+
+	QRectF sourceRect = tempScene->getRenderRect(options);
+	if (sourceRect.isEmpty())
+		return QImage();
+
+	double scale = qMin(1.0, maxSide / qMax(sourceRect.width(), sourceRect.height()));
+	QSize imageSize = (sourceRect.size() * scale).toSize().expandedTo(QSize(1, 1));
+
+	QPicture picture;
+	QPainter recorder(&picture);
+	recorder.setRenderHint(QPainter::Antialiasing);
+	recorder.setRenderHint(QPainter::TextAntialiasing);
+	tempScene->renderScene(&recorder, QRectF(QPointF(0, 0), imageSize), options);
+	recorder.end();
+
+	tempScene.reset();
+
+	// rasterize on the worker threads, by bands
+	QImage image(imageSize, QImage::Format_ARGB32);
+	image.fill(Qt::white);
+
+	QByteArray pictureData(picture.data(), int(picture.size()));
+	uchar* bits = image.bits();
+	int bytesPerLine = image.bytesPerLine();
+	const int bandHeight = 256;
+
+	QVector<int> bandTops;
+	for (int top = 0; top < imageSize.height(); top += bandHeight)
+		bandTops << top;
+
+	QtConcurrent::blockingMap(bandTops, [&](int top)
+	{
+		// own copy: QPicture playback is not reentrant
+		QPicture bandPicture;
+		bandPicture.setData(pictureData.constData(), pictureData.size());
+
+		int height = qMin(bandHeight, imageSize.height() - top);
+		QImage band(bits + qint64(top) * bytesPerLine, imageSize.width(), height, bytesPerLine, QImage::Format_ARGB32);
+
+		QPainter painter(&band);
+		painter.setRenderHint(QPainter::Antialiasing);
+		painter.setRenderHint(QPainter::TextAntialiasing);
+		painter.translate(0, -top);
+		painter.drawPicture(0, 0, bandPicture);
+		painter.end();
+	});
+
+	return image;
+}
+
+
 void CEditorScene::copy()
 {
 	// store selected items only
@@ -860,32 +1209,10 @@ void CEditorScene::copy()
 		citem->storeTo(out, version64);
 	}
 
-	// create mime object
-	QMimeData* mimeData = new QMimeData;
+	// create mime object: the image is rendered only if somebody asks for it
+	QMimeData* mimeData = new CSelectionMimeData(*this);
 	mimeData->setData("qvgelib/selection", buffer);
 	QApplication::clipboard()->setMimeData(mimeData);
-
-	// paste it to a temp scene & render into mime image
-	CEditorScene* tempScene = createScene();
-	tempScene->copyProperties(*this);
-	tempScene->enableGrid(false);
-	tempScene->paste();
-	tempScene->deselectAll();
-	tempScene->crop();
-
-	QImage image(tempScene->sceneRect().size().toSize(), QImage::Format_ARGB32);
-	image.fill(Qt::white);
-
-	QPainter painter(&image);
-	painter.setRenderHint(QPainter::Antialiasing);
-	painter.setRenderHint(QPainter::TextAntialiasing);
-	tempScene->render(&painter);
-	painter.end();
-
-	mimeData->setImageData(QVariant(image));
-	QApplication::clipboard()->setMimeData(mimeData);
-
-	delete tempScene;
 }
 
 
@@ -1167,7 +1494,12 @@ QList<CItem*> CEditorScene::cloneSelectedItems()
 
 void CEditorScene::crop()
 {
-	QRectF itemsRect = itemsBoundingRect().adjusted(-20, -20, 20, 20);
+	flushPendingGeometry();
+
+	RenderOptions cropOptions;
+	cropOptions.cropToContent = true;
+
+	QRectF itemsRect = getRenderRect(cropOptions);
 	if (itemsRect == sceneRect())
 		return;
 
@@ -1178,6 +1510,59 @@ void CEditorScene::crop()
 }
 
 
+// rendering
+
+QRectF CEditorScene::getRenderRect(const RenderOptions& options) const
+{
+	// the scheduled edge geometry is a cache of the node moves: make it actual
+	const_cast<CEditorScene*>(this)->flushPendingGeometry();
+
+	if (options.sourceRect.isValid())
+		return options.sourceRect;
+
+	if (options.cropToContent)
+		return itemsBoundingRect().adjusted(-20, -20, 20, 20);
+
+	return sceneRect();
+}
+
+
+void CEditorScene::renderScene(QPainter *painter, const QRectF& targetRect, const RenderOptions& options)
+{
+	// the decorations are switched off for the time of rendering only: nobody has to know
+	bool wasBlocked = blockSignals(true);
+
+	QRectF oldSceneRect = sceneRect();
+	QRectF renderRect = getRenderRect(options);
+	if (renderRect != oldSceneRect)
+		setSceneRect(renderRect);		// background & grid follow the rendered area
+
+	bool gridEnabled = m_gridEnabled;
+	m_gridEnabled = gridEnabled && options.showGrid;
+
+	ISceneEditController *editController = m_editController;
+	if (!options.showEditControls)
+		m_editController = nullptr;
+
+	// at paint time only: the selection itself is not touched
+	bool selectionHidden = m_selectionHidden;
+	m_selectionHidden = selectionHidden || !options.showSelection;
+
+	render(painter, targetRect, renderRect);
+
+	// restore
+	m_selectionHidden = selectionHidden;
+
+	m_editController = editController;
+	m_gridEnabled = gridEnabled;
+
+	if (renderRect != oldSceneRect)
+		setSceneRect(oldSceneRect);
+
+	blockSignals(wasBlocked);
+}
+
+
 // transform
 
 QList<QGraphicsItem*> CEditorScene::getTransformableItems() const
@@ -1188,9 +1573,89 @@ QList<QGraphicsItem*> CEditorScene::getTransformableItems() const
 
 // callbacks
 
+void CEditorScene::onItemAdded(CItem *citem)
+{
+	Q_ASSERT(citem);
+
+	m_itemsRegistry.add(citem, citem);
+	m_itemsByClass[citem->classId()].add(citem, citem);
+	m_itemsById.insert(citem->getId(), citem);
+
+	invalidateItemLabel(citem);
+
+	if (m_undoManager)
+		m_undoManager->onItemAdded(citem);
+}
+
+
+void CEditorScene::onItemRemoved(CItem *citem)
+{
+	Q_ASSERT(citem);
+
+	m_itemsRegistry.remove(citem);
+	m_itemsByClass[citem->classId()].remove(citem);
+	m_itemsById.remove(citem->getId(), citem);
+	m_uniqueIdHints.clear();
+
+	forgetItemLabel(citem);
+
+	if (m_undoManager)
+		m_undoManager->onItemRemoved(citem);
+}
+
+
 void CEditorScene::onItemDestroyed(CItem *citem)
 {
 	Q_ASSERT(citem);
+
+	m_itemsRegistry.remove(citem);
+	m_itemsById.remove(citem->getId(), citem);
+	m_uniqueIdHints.clear();
+
+	// classId() is not available anymore
+	for (auto& classItems : m_itemsByClass)
+	{
+		if (classItems.remove(citem))
+			break;
+	}
+
+	forgetItemLabel(citem);
+
+	// the item is gone for the scene
+	if (m_undoManager)
+		m_undoManager->onItemRemoved(citem);
+}
+
+
+void CEditorScene::onItemIdChanged(CItem *citem, const QString& oldId)
+{
+	Q_ASSERT(citem);
+
+	m_itemsById.remove(oldId, citem);
+	m_itemsById.insert(citem->getId(), citem);
+
+	// the old id could be free now
+	m_uniqueIdHints.clear();
+}
+
+
+void CEditorScene::onItemAttributeChanged(CItem *citem, const QByteArray& attrId)
+{
+	Q_EMIT itemAttributeChanged(citem, attrId);
+}
+
+
+void CEditorScene::onControlPointAdded(CControlPoint *cp)
+{
+	Q_ASSERT(cp);
+
+	m_controlPoints.add(cp, cp);
+}
+
+
+void CEditorScene::onControlPointRemoved(CControlPoint *cp)
+{
+	m_controlPoints.remove(cp);
 }
 
 
@@ -1231,22 +1696,17 @@ void CEditorScene::onFocusItemChanged(QGraphicsItem *newFocusItem, QGraphicsItem
 void CEditorScene::drawBackground(QPainter *painter, const QRectF &)
 {
 	// invalidate items if needed
-	if (m_needUpdateItems)
-	{
-		m_needUpdateItems = false;
-		auto citems = getItems<CItem>();
-		for (auto citem : citems)
-		{
-			citem->updateCachedItems();
-			citem->getSceneItem()->update();
-		}
-	}
+	updateDirtyItems();
 
 	// update layout if needed
 	if (m_labelsUpdate)
 	{
 		layoutItemLabels();
 	}
+	else if (!m_dirtyLabelItems.isEmpty())
+	{
+		layoutDirtyItemLabels();
+	}
 
 	// fill background
 	if (painter->paintEngine()->type() == QPaintEngine::OpenGL || painter->paintEngine()->type() == QPaintEngine::OpenGL2)
@@ -1296,15 +1756,19 @@ void CEditorScene::drawForeground(QPainter *painter, const QRectF &r)
 }
 
 
-bool CEditorScene::checkLabelRegion(const QRectF &r)
+bool CEditorScene::checkLabelRegion(CItem *citem, const QRectF &r)
 {
 	if (!r.isValid())
 		return false;
 
-	if (m_usedLabelsRegion.intersects(r))
+	if (m_usedLabelsGrid.intersects(r))
+	{
+		// keep it to retry when some space is freed
+		m_hiddenLabelsGrid.insert(citem, r);
 		return false;
+	}
 
-	m_usedLabelsRegion.addRect(r);
+	m_usedLabelsGrid.insert(citem, r);
 	return true;
 }
 
@@ -1324,8 +1788,8 @@ void CEditorScene::setLabelsPolicy(CEditorScene::LabelsPolicy v)
 
 void CEditorScene::layoutItemLabels()
 {
-	// reset region
-	m_usedLabelsRegion = QPainterPath();
+	// full layout: drop incremental changes
+	m_dirtyLabelItems.clear();
 
 	QList<CItem*> allItems = getItems<CItem>();
 
@@ -1335,6 +1799,9 @@ void CEditorScene::layoutItemLabels()
 	// hide all if disabled
 	if (!m_labelsEnabled || labelPolicy == AlwaysOff)
 	{
+		m_usedLabelsGrid.clear();
+		m_hiddenLabelsGrid.clear();
+
 		for (auto citem : allItems)
 		{
 			citem->showLabel(false);
@@ -1346,32 +1813,141 @@ void CEditorScene::layoutItemLabels()
 	//QElapsedTimer tm;
 	//tm.start();
 
-	// else layout texts
+	// update texts first: cell size depends on the average label size
+	qreal labelsSize = 0;
+	int labelsCount = 0;
+
 	for (auto citem : allItems)
 	{
 		citem->updateLabelContent();
 		citem->updateLabelPosition();
 
-		if (citem == m_editItem)
+		QRectF labelRect = citem->getSceneLabelRect();
+		if (labelRect.isValid())
 		{
+			labelsSize += qMax(labelRect.width(), labelRect.height());
+			labelsCount++;
+		}
+	}
+
+	qreal cellSize = labelsCount ? labelsSize / labelsCount * 2 : 100;
+	m_usedLabelsGrid.clear(cellSize);
+	m_hiddenLabelsGrid.clear(cellSize);
+
+	// upper items get their labels placed first
+	std::stable_sort(allItems.begin(), allItems.end(), [](CItem* i1, CItem* i2) {
+		return i1->getSceneItem()->zValue() > i2->getSceneItem()->zValue();
+	});
+
+	// else layout texts
+	for (auto citem : allItems)
+	{
+		placeItemLabel(citem, labelPolicy);
+	}
+
+	//qDebug() << "layout labels: " << tm.elapsed();
+}
+
+
+void CEditorScene::invalidateItemLabel(CItem *citem)
+{
+	if (m_labelsUpdate || m_dirtyLabelItems.contains(citem))
+		return;
+
+	m_dirtyLabelItems.insert(citem);
+
+	update();
+}
+
+
+void CEditorScene::layoutDirtyItemLabels()
+{
+	auto labelPolicy = getLabelsPolicy();
+
+	QSet<CItem*> dirtyItems;
+	dirtyItems.swap(m_dirtyLabelItems);
+
+	if (!m_labelsEnabled || labelPolicy == AlwaysOff)
+	{
+		for (auto citem : dirtyItems)
 			citem->showLabel(false);
-			m_pimpl->m_labelEditor.onItemLayout();
-			continue;
+
+		return;
+	}
+
+	// free the space taken by the changed labels
+	QList<QRectF> freedRects;
+
+	for (auto citem : dirtyItems)
+	{
+		if (m_usedLabelsGrid.contains(citem))
+		{
+			freedRects << m_usedLabelsGrid.rect(citem);
+			m_usedLabelsGrid.remove(citem);
 		}
 
-		if (labelPolicy == AlwaysOn)
+		m_hiddenLabelsGrid.remove(citem);
+	}
+
+	// layout the changed labels
+	for (auto citem : dirtyItems)
+	{
+		citem->updateLabelContent();
+		citem->updateLabelPosition();
+
+		placeItemLabel(citem, labelPolicy);
+	}
+
+	// hidden labels could fit into the freed space now
+	for (const QRectF& r : freedRects)
+	{
+		for (auto citem : m_hiddenLabelsGrid.query(r))
 		{
-			citem->showLabel(true);
-			continue;
+			QRectF labelRect = m_hiddenLabelsGrid.rect(citem);
+			if (!m_usedLabelsGrid.intersects(labelRect))
+			{
+				m_hiddenLabelsGrid.remove(citem);
+				m_usedLabelsGrid.insert(citem, labelRect);
+				citem->showLabel(true);
+			}
 		}
+	}
+}
 
-		QRectF labelRect = citem->getSceneLabelRect();
-		QRectF reducedRect(labelRect.topLeft() / 10, labelRect.size() / 10);
 
-		citem->showLabel(checkLabelRegion(reducedRect));
+void CEditorScene::forgetItemLabel(CItem *citem)
+{
+	m_dirtyLabelItems.remove(citem);
+	m_hiddenLabelsGrid.remove(citem);
+
+	if (m_usedLabelsGrid.contains(citem))
+	{
+		QRectF r = m_usedLabelsGrid.rect(citem);
+		m_usedLabelsGrid.remove(citem);
+
+		// hidden labels could fit into the freed space now
+		for (auto hiddenItem : m_hiddenLabelsGrid.query(r))
+			invalidateItemLabel(hiddenItem);
 	}
+}
 
-	//qDebug() << "layout labels: " << tm.elapsed();
+
+void CEditorScene::placeItemLabel(CItem *citem, LabelsPolicy labelPolicy)
+{
+	if (citem == m_editItem)
+	{
+		citem->showLabel(false);
+		m_pimpl->m_labelEditor.onItemLayout();
+		return;
+	}
+
+	if (labelPolicy == AlwaysOn)
+	{
+		citem->showLabel(true);
+		return;
+	}
+
+	citem->showLabel(checkLabelRegion(citem, citem->getSceneLabelRect()));
 }
 
 
@@ -1384,6 +1960,78 @@ void CEditorScene::needUpdate()
 }
 
 
+void CEditorScene::invalidateClass(const QByteArray& classId)
+{
+	// scene attributes can affect everything
+	if (classId == class_scene)
+	{
+		needUpdate();
+		return;
+	}
+
+	if (m_needUpdateItems)
+		return;
+
+	m_dirtyClasses.insert(classId);
+
+	update();
+}
+
+
+void CEditorScene::updateDirtyItems()
+{
+	if (m_needUpdateItems)
+	{
+		m_needUpdateItems = false;
+		m_dirtyClasses.clear();
+
+		for (auto citem : m_itemsRegistry)
+		{
+			citem->updateCachedItems();
+			citem->getSceneItem()->update();
+		}
+
+		return;
+	}
+
+	if (m_dirtyClasses.isEmpty())
+		return;
+
+	QSet<QByteArray> dirtyClasses;
+	dirtyClasses.swap(m_dirtyClasses);
+
+	for (auto it = m_itemsByClass.constBegin(); it != m_itemsByClass.constEnd(); ++it)
+	{
+		// the class itself or one of its superclasses has been changed
+		bool isDirty = false;
+		QByteArray id = it.key();
+		QSet<QByteArray> visited;
+		while (!id.isEmpty() && !visited.contains(id))
+		{
+			if (dirtyClasses.contains(id))
+			{
+				isDirty = true;
+				break;
+			}
+
+			visited << id;
+			id = getSuperClassId(id);
+		}
+
+		if (!isDirty)
+			continue;
+
+		for (auto citem : *it)
+		{
+			citem->updateCachedItems();
+			citem->getSceneItem()->update();
+
+			invalidateItemLabel(citem);
+		}
+	}
+}
+
+
 // mousing
 
 void CEditorScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
@@ -13,10 +13,13 @@ It can be used freely, maintaining the information above.
 #include <QGraphicsScene>
 #include <QGraphicsRectItem>
 #include <QSet>
+#include <QHash>
 #include <QMenu>
 #include <QByteArrayList>
 
 #include "CAttribute.h"
+#include "CSpatialGrid.h"
+#include "CItemRegistry.h"
 
 
 class IUndoManager;
@@ -26,6 +29,7 @@ class ISceneMenuController;
 class ISceneEditController;
 
 class CItem;
+class CControlPoint;
 class CEditorSceneActions;
 
 struct Graph;
@@ -53,6 +57,7 @@ public:
 	typedef QGraphicsScene Super;
 
 	friend class CEditorScene_p;
+	friend class CCommandUndoManager;
 
     CEditorScene(QObject *parent = NULL);
 	virtual ~CEditorScene();
@@ -99,10 +104,17 @@ public:
 	void revertUndoState();
 	// sets initial scene state
 	void setInitialState();
+	// returns undo manager if it records fine-grained changes, else NULL
+	IUndoManager* getChangeTracker() const;
 
 	// serialization 
 	virtual bool storeTo(QDataStream& out, bool storeOptions) const;
 	virtual bool restoreFrom(QDataStream& out, bool readOptions);
+	static quint64 storageVersion();
+
+	// scene settings only: class attributes, visibility, options & scene rect
+	virtual bool storeSettingsTo(QDataStream& out, bool storeOptions) const;
+	virtual bool restoreSettingsFrom(QDataStream& out, quint64 storedVersion, bool readOptions);
 
 	// item factories
 	template<class T>
@@ -149,6 +161,13 @@ public:
 	const CAttribute getClassAttribute(const QByteArray& classId, const QByteArray& attrId, bool inherited) const;
 	AttributesMap getClassAttributes(const QByteArray& classId, bool inherited) const;
 
+	// effective class attributes with resolved inheritance.
+	// the returned table stays valid until getClassAttributesVersion() changes.
+	typedef QHash<QByteArray, CAttribute> ResolvedAttributes;
+	const ResolvedAttributes& getResolvedClassAttributes(const QByteArray& classId) const;
+	const CAttribute* getResolvedClassAttribute(const QByteArray& classId, const QByteArray& attrId) const;
+	quint64 getClassAttributesVersion() const { return m_classAttributesVersion; }
+
 	bool removeClassAttribute(const QByteArray& classId, const QByteArray& attrId);
 
 	void setClassAttribute(const QByteArray& classId, const CAttribute& attr, bool vis = false);
@@ -177,9 +196,16 @@ public:
 	template<class T = CItem, class L = T>
 	QList<T*> getItems() const;
 
+	const CItemRegistry<CItem>& getRegisteredItems() const	{ return m_itemsRegistry; }
+	const CItemRegistry<CControlPoint>& getControlPoints() const	{ return m_controlPoints; }
+
 	template<class T = CItem>
 	QList<T*> getItemsById(const QString& id) const;
 
+	// returns the first free id made from tmpl (i.e. "N%1")
+	template<class T = CItem>
+	QString createUniqueId(const QString& tmpl) const;
+
 	QGraphicsItem* getItemAt(const QPointF& pos) const;
 
 	template<class T>
@@ -240,11 +266,30 @@ public:
 		return m_menuTriggerItem;
 	}
 
+	// rendering of the current content without editing decorations (i.e. for export)
+	struct RenderOptions
+	{
+		bool showGrid = false;
+		bool showSelection = false;
+		bool showEditControls = false;
+		bool cropToContent = false;		// items bounding rect with a margin instead of the scene rect
+		QRectF sourceRect;				// if valid: the area to render
+	};
+
+	QRectF getRenderRect(const RenderOptions& options) const;
+	void renderScene(QPainter *painter, const QRectF& targetRect, const RenderOptions& options);
+
+	// true while renderScene() runs without the selection: the items paint themselves as not selected
+	bool isSelectionHidden() const		{ return m_selectionHidden; }
+
 	// other
-	bool checkLabelRegion(const QRectF& r);
+	bool checkLabelRegion(CItem *citem, const QRectF& r);
 	void layoutItemLabels();
+	void invalidateItemLabel(CItem *citem);
 
 	void needUpdate();
+	// refreshes only the items of the class & its subclasses (batched until the next frame)
+	void invalidateClass(const QByteArray& classId);
 
 	virtual QPointF getSnapped(const QPointF& pos) const;
 
@@ -255,7 +300,17 @@ public:
 	QGraphicsView* getCurrentView();
 
 	// callbacks
+	virtual void onItemAdded(CItem *citem);
+	virtual void onItemRemoved(CItem *citem);
 	virtual void onItemDestroyed(CItem *citem);
+	virtual void onItemIdChanged(CItem *citem, const QString& oldId);
+	virtual void onItemAttributeChanged(CItem *citem, const QByteArray& attrId);
+	virtual void onItemGeometryChanged(CItem* /*citem*/) {}
+
+	// applies the geometry updates deferred until the next frame
+	virtual void flushPendingGeometry() {}
+	void onControlPointAdded(CControlPoint *cp);
+	void onControlPointRemoved(CControlPoint *cp);
 
 public Q_SLOTS:
     void enableGrid(bool on = true);
@@ -288,6 +343,8 @@ Q_SIGNALS:
 	void redoAvailable(bool);
 
 	void sceneChanged();
+	// direct: an attribute (or the id) of an item on the scene has been set or removed
+	void itemAttributeChanged(CItem *item, const QByteArray& attrId);
 	void sceneDoubleClicked(QGraphicsSceneMouseEvent* mouseEvent, QGraphicsItem* clickedItem);
 
 	void infoStatusChanged(int status);
@@ -346,8 +403,24 @@ protected Q_SLOTS:
 
 private:
 	void removeItems();
+	bool restoreItemsFrom(QDataStream& out, bool readOptions);
 	void checkUndoState();
 
+	// undo support
+	QByteArray storeSceneState() const;
+	void restoreSceneState(const QByteArray& state);
+	void restoreClassAttribute(const QByteArray& classId, const QByteArray& attrId, const CAttribute& attr);
+
+	// class attributes
+	void invalidateClassAttributes();
+
+	void updateDirtyItems();
+
+	// labels
+	void layoutDirtyItemLabels();
+	void placeItemLabel(CItem *citem, LabelsPolicy labelPolicy);
+	void forgetItemLabel(CItem *citem);
+
 protected:
 	QPointF m_leftClickPos;
 	QPointF m_mousePos;
@@ -385,17 +458,37 @@ private:
     QMap<QByteArray, QSet<QByteArray>> m_classAttributesVis;
 	AttributeConstrainsMap m_classAttributesConstrains;
 
+	quint64 m_classAttributesVersion = 0;
+	mutable quint64 m_resolvedAttributesVersion = 0;
+	mutable QHash<QByteArray, ResolvedAttributes> m_resolvedClassAttributes;
+	static quint64 s_classAttributesVersionCounter;
+
     int m_gridSize;
     bool m_gridEnabled;
     bool m_gridSnap;
     QPen m_gridPen;
 
+	bool m_selectionHidden = false;
+
 	bool m_needUpdateItems = true;
 
+	// dirty tracking
+	QHash<QByteArray, CItemRegistry<CItem>> m_itemsByClass;
+	QSet<QByteArray> m_dirtyClasses;
+
+	// item registries
+	CItemRegistry<CItem> m_itemsRegistry;
+	CItemRegistry<CControlPoint> m_controlPoints;
+
+	// id index
+	QMultiHash<QString, CItem*> m_itemsById;
+	mutable QHash<QString, int> m_uniqueIdHints;
+
 	QPointF m_pastePos;
 
 	// labels
-	QPainterPath m_usedLabelsRegion;
+	CSpatialGrid<CItem*> m_usedLabelsGrid, m_hiddenLabelsGrid;
+	QSet<CItem*> m_dirtyLabelItems;
 	bool m_labelsEnabled, m_labelsUpdate;
 
 	bool m_isFontAntialiased = true;
@@ -454,9 +547,10 @@ template<class T, class L>
 QList<T*> CEditorScene::getItems() const
 {
 	QList<T*> result;
+	result.reserve(m_itemsRegistry.size());
 
-	auto allItems = items();
-	for (auto item : allItems)
+	// only the registered CItems are checked for the type
+	for (auto item : m_itemsRegistry)
 	{
 		T* titem = dynamic_cast<L*>(item);
 		if (titem)
@@ -472,12 +566,11 @@ QList<T*> CEditorScene::getItemsById(const QString& id) const
 {
 	QList<T*> res;
 
-	auto allItems = items();
-	for (auto item : allItems)
+	// only the items with this id are checked for the type
+	for (auto it = m_itemsById.constFind(id); it != m_itemsById.constEnd() && it.key() == id; ++it)
 	{
-		T* titem = dynamic_cast<T*>(item);
-
-		if (titem && titem->getId() == id)
+		T* titem = dynamic_cast<T*>(it.value());
+		if (titem)
 			res << titem;
 	}
 
@@ -485,4 +578,22 @@ QList<T*> CEditorScene::getItemsById(const QString& id) const
 }
 
 
+template<class T>
+QString CEditorScene::createUniqueId(const QString& tmpl) const
+{
+	// all the ids below the hint are in use (hints are dropped on removal or renaming)
+	const QString hintKey = QString::fromLatin1(T::factoryId()) + tmpl;
+	int count = m_uniqueIdHints.value(hintKey, 0);
+
+	QString newId;
+	do
+		newId = tmpl.arg(++count);
+	while (!getItemsById<T>(newId).isEmpty());
+
+	m_uniqueIdHints[hintKey] = count;
+
+	return newId;
+}
+
+
 #endif // CEDITORSCENE_H
@@ -11,13 +11,6 @@ It can be used freely, maintaining the information above.
 
 #include "IFileSerializer.h"
 
-#include <QtXml/QDomDocument>
-#include <QByteArray>
-#include <QMap>
-#include <QVariant>
-
-class CNode;
-
 
 class CFileSerializerGEXF : public IFileSerializer 
 {
@@ -47,30 +40,4 @@ public:
 	}
 
 	virtual bool save(const QString& fileName, CEditorScene& scene, QString* lastError = nullptr) const;
-
-private:
-    struct AttrInfo {
-        QByteArray id;
-        int variantType;
-    };
-    typedef QMap<QByteArray, AttrInfo> IdToAttrMap;
-    mutable QMap<QByteArray, IdToAttrMap> m_classIdMap;
-
-    bool readAttrs(int index, const QDomNode &domNode, CEditorScene& scene) const;
-    bool readNode(int index, const QDomNode &domNode, const IdToAttrMap &idMap, CEditorScene& scene) const;
-    bool readEdge(int index, const QDomNode &domNode, const IdToAttrMap &idMap, CEditorScene& scene) const;
-	void writeClassAttrs(QTextStream &ts, const CEditorScene& scene, const QByteArray &classId) const;
-	void writeNodes(QTextStream &ts, const CEditorScene& scene) const;
-	void writeEdges(QTextStream &ts, const CEditorScene& scene) const;
-	void writeAttValues(QTextStream &ts, const QMap<QByteArray, QVariant>& attvalues) const;
-
-	mutable QMap<QString, CNode*> m_nodeMap;
-
-	enum EdgeType {
-		Directed,
-		Undirected,
-		Mutual
-	};
-	mutable QString m_edgeType;
 };
-
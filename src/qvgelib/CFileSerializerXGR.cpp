@@ -10,9 +10,18 @@ It can be used freely, maintaining the information above.
 #include "CFileSerializerXGR.h"
 #include "CEditorScene.h"
 #include "ISceneItemFactory.h"
+#include "CNode.h"
+#include "CNodePort.h"
+#include "CEdge.h"
+#include "CPolyEdge.h"
 
 #include <QtCore/QFile>
 #include <QtCore/QDataStream>
+#include <QtCore/QBuffer>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+#include <cstring>
 
 
 // static reader with DPSE format support
@@ -44,15 +53,247 @@ public:
 static CDPSERecoder s_dpseRecoder;
 
 
+// XGR v2 layout: header, section table, sections.
+// Sections & the arrays inside are 8 bytes aligned, so the mapped file can be read in place.
+//
+// STRS: u32 offsets[count+1], utf8 data						- attribute keys, type & port ids
+// NODE: f64 x[], y[], z[], width[], height[], u32 type[], attrs[], idOffsets[count+1], utf8 ids
+// EDGE: u32 type[], first[], last[], firstPort[], lastPort[], attrs[], idOffsets[count+1], utf8 ids
+// PNTS: u32 edge[], pointOffsets[count+1], f64 xy[]			- polyline points
+// PORT: QDataStream: (u32 node, int count, (id, align, x, y, brush, pen, rect) * count) * count
+// ATTR: QDataStream: (u32 count, (u32 key, QVariant value) * count) per item, items refer to the offset
+// OTHR: QDataStream: (typeId, item data) * count				- items which are not nodes or edges
+// SCNE: QDataStream: class attributes, visibility, options, scene rect
+
+static const char xgrMagic[4] = { 'X', 'G', 'R', '2' };
+static const quint32 xgrByteOrder = 0x01020304;
+static const quint32 xgrNone = 0xffffffff;
+
+static constexpr quint32 xgrTag(const char (&s)[5])
+{
+	return quint32(uchar(s[0])) | (quint32(uchar(s[1])) << 8) | (quint32(uchar(s[2])) << 16) | (quint32(uchar(s[3])) << 24);
+}
+
+struct XGRHeader
+{
+	char magic[4];
+	quint32 byteOrder;			// as written by the host
+	quint64 storageVersion;		// of the items & attributes data
+	quint32 dataStreamVersion;
+	quint32 sectionsCount;
+};
+
+struct XGRSection
+{
+	quint32 tag;
+	quint32 count;				// records in the section
+	quint64 offset;				// from the file start
+	quint64 size;
+};
+
+
+static inline quint64 xgrAligned(quint64 size)
+{
+	return (size + 7) & ~quint64(7);
+}
+
+
+static void xgrPad(QByteArray& data)
+{
+	int size = int(xgrAligned(data.size()));
+	if (size > data.size())
+		data.append(size - data.size(), '\0');
+}
+
+
+template<class T>
+static void xgrAppend(QByteArray& data, const QVector<T>& v)
+{
+	data.append(reinterpret_cast<const char*>(v.constData()), int(v.size() * sizeof(T)));
+	xgrPad(data);
+}
+
+
+// sequential reading of the section arrays
+class XGRArrayReader
+{
+public:
+	XGRArrayReader(const uchar* data, quint64 size): m_data(data), m_size(size) {}
+
+	template<class T>
+	const T* next(quint64 count)
+	{
+		quint64 bytes = count * sizeof(T);
+		if (m_pos + bytes > m_size)
+		{
+			m_failed = true;
+			return nullptr;
+		}
+
+		auto ptr = reinterpret_cast<const T*>(m_data + m_pos);
+		m_pos += xgrAligned(bytes);
+		return ptr;
+	}
+
+	const char* rest(quint64 bytes)
+	{
+		if (m_pos + bytes > m_size)
+		{
+			m_failed = true;
+			return nullptr;
+		}
+
+		return reinterpret_cast<const char*>(m_data + m_pos);
+	}
+
+	bool failed() const { return m_failed; }
+
+private:
+	const uchar* m_data;
+	quint64 m_size;
+	quint64 m_pos = 0;
+	bool m_failed = false;
+};
+
+
+class XGRStringTable
+{
+public:
+	quint32 index(const QByteArray& s)
+	{
+		auto it = m_index.constFind(s);
+		if (it != m_index.constEnd())
+			return it.value();
+
+		quint32 i = m_strings.size();
+		m_index[s] = i;
+		m_strings << s;
+		return i;
+	}
+
+	QByteArray toSection() const
+	{
+		QVector<quint32> offsets;
+		offsets.reserve(m_strings.size() + 1);
+
+		QByteArray pool;
+		for (const auto& s : m_strings)
+		{
+			offsets << pool.size();
+			pool += s;
+		}
+		offsets << pool.size();
+
+		QByteArray data;
+		xgrAppend(data, offsets);
+		data += pool;
+		xgrPad(data);
+		return data;
+	}
+
+	int count() const { return m_strings.size(); }
+
+private:
+	QVector<QByteArray> m_strings;
+	QHash<QByteArray, quint32> m_index;
+};
+
+
+static void appendIds(QByteArray& data, const QVector<QByteArray>& ids)
+{
+	QVector<quint32> offsets;
+	offsets.reserve(ids.size() + 1);
+
+	QByteArray pool;
+	for (const auto& id : ids)
+	{
+		offsets << pool.size();
+		pool += id;
+	}
+	offsets << pool.size();
+
+	xgrAppend(data, offsets);
+	data += pool;
+	xgrPad(data);
+}
+
+
+static bool readHeader(const uchar* data, qint64 size, const XGRSection*& sections, QString* lastError)
+{
+	if (size < qint64(sizeof(XGRHeader)) || memcmp(data, xgrMagic, 4) != 0)
+		return false;
+
+	auto header = reinterpret_cast<const XGRHeader*>(data);
+	if (header->byteOrder != xgrByteOrder)
+	{
+		if (lastError)
+			*lastError = QObject::tr("Byte order of the file is not supported");
+		return false;
+	}
+
+	sections = reinterpret_cast<const XGRSection*>(data + sizeof(XGRHeader));
+	if (sizeof(XGRHeader) + quint64(header->sectionsCount) * sizeof(XGRSection) > quint64(size))
+		return false;
+
+	for (quint32 i = 0; i < header->sectionsCount; ++i)
+	{
+		if (sections[i].offset + sections[i].size > quint64(size) || (sections[i].offset & 7))
+			return false;
+	}
+
+	return true;
+}
+
+
+static const XGRSection* findSection(const uchar* data, const XGRSection* sections, quint32 tag)
+{
+	auto header = reinterpret_cast<const XGRHeader*>(data);
+
+	for (quint32 i = 0; i < header->sectionsCount; ++i)
+		if (sections[i].tag == tag)
+			return &sections[i];
+
+	return nullptr;
+}
+
+
 // reimp
 
-bool CFileSerializerXGR::load(const QString& fileName, CEditorScene& scene, QString* /*lastError*/) const
+bool CFileSerializerXGR::load(const QString& fileName, CEditorScene& scene, QString* lastError) const
 {
 	// read file into document
 	QFile openFile(fileName);
 	if (!openFile.open(QIODevice::ReadOnly))
 		return false;
 
+	char magic[4] = { 0 };
+	if (openFile.peek(magic, 4) != 4 || memcmp(magic, xgrMagic, 4) != 0)
+		return loadV1(openFile, scene, lastError);
+
+	// v2: map the file if possible, else read it at once
+	QByteArray content;
+	uchar* mapped = openFile.map(0, openFile.size());
+	const uchar* data = mapped;
+	qint64 size = openFile.size();
+
+	if (!mapped)
+	{
+		content = openFile.readAll();
+		data = reinterpret_cast<const uchar*>(content.constData());
+		size = content.size();
+	}
+
+	bool ok = loadV2(data, size, scene, lastError);
+
+	if (mapped)
+		openFile.unmap(mapped);
+
+	return ok;
+}
+
+
+bool CFileSerializerXGR::loadV1(QFile& openFile, CEditorScene& scene, QString* /*lastError*/) const
+{
 	scene.reset();
 
     scene.setItemFactoryFilter(&s_dpseRecoder);
@@ -72,20 +313,601 @@ bool CFileSerializerXGR::load(const QString& fileName, CEditorScene& scene, QStr
 }
 
 
-bool CFileSerializerXGR::save(const QString& fileName, CEditorScene& scene, QString* /*lastError*/) const
+bool CFileSerializerXGR::loadV2(const uchar* data, qint64 size, CEditorScene& scene, QString* lastError) const
+{
+	const XGRSection* sections = nullptr;
+	if (!readHeader(data, size, sections, lastError))
+	{
+		if (lastError && lastError->isEmpty())
+			*lastError = QObject::tr("Broken XGR file");
+		return false;
+	}
+
+	auto header = reinterpret_cast<const XGRHeader*>(data);
+	quint64 storedVersion = header->storageVersion;
+	int streamVersion = int(header->dataStreamVersion);
+
+	auto sectionData = [&](quint32 tag, const XGRSection*& section) -> const uchar*
+	{
+		section = findSection(data, sections, tag);
+		return section ? data + section->offset : nullptr;
+	};
+
+	auto sectionStream = [](const uchar* ptr, const XGRSection* section) -> QByteArray
+	{
+		// no copy: the data stays mapped while loading
+		return QByteArray::fromRawData(reinterpret_cast<const char*>(ptr), int(section->size));
+	};
+
+	scene.reset();
+
+	// strings
+	QVector<QByteArray> strings;
+	const XGRSection* strSection = nullptr;
+	if (const uchar* ptr = sectionData(xgrTag("STRS"), strSection))
+	{
+		XGRArrayReader reader(ptr, strSection->size);
+		const quint32* offsets = reader.next<quint32>(strSection->count + 1);
+		const char* pool = offsets ? reader.rest(offsets[strSection->count]) : nullptr;
+		if (!pool)
+			return false;
+
+		strings.reserve(strSection->count);
+		for (quint32 i = 0; i < strSection->count; ++i)
+			strings << QByteArray(pool + offsets[i], offsets[i + 1] - offsets[i]);
+	}
+
+	// local attributes: read on demand by the item offset
+	const XGRSection* attrSection = nullptr;
+	const uchar* attrPtr = sectionData(xgrTag("ATTR"), attrSection);
+	QByteArray attrData = attrPtr ? sectionStream(attrPtr, attrSection) : QByteArray();
+	QDataStream attrStream(attrData);
+	attrStream.setVersion(streamVersion);
+
+	bool withAttrs = attrPtr && (m_loadParts & LoadAttributes);
+
+	auto restoreItem = [&](CItem* item, quint32 attrOffset, const char* id, quint32 idSize)
+	{
+		QMap<QByteArray, QVariant> attrs;
+
+		if (withAttrs && attrOffset != xgrNone && attrStream.device()->seek(attrOffset))
+		{
+			quint32 count = 0;
+			attrStream >> count;
+
+			for (quint32 i = 0; i < count; ++i)
+			{
+				quint32 key = 0;
+				QVariant value;
+				attrStream >> key >> value;
+				attrs[strings.value(key)] = value;
+			}
+		}
+
+		item->restoreAttributes(attrs, QString::fromUtf8(id, idSize));
+	};
+
+	QList<CItem*> items;
+
+	auto failed = [&](const QString& text) -> bool
+	{
+		qDeleteAll(items);
+
+		if (lastError)
+			*lastError = text;
+
+		return false;
+	};
+
+	// nodes
+	QVector<CNode*> nodes;
+	const XGRSection* nodeSection = nullptr;
+	const uchar* nodePtr = sectionData(xgrTag("NODE"), nodeSection);
+
+	if (nodePtr && (m_loadParts & LoadNodes))
+	{
+		quint32 count = nodeSection->count;
+
+		XGRArrayReader reader(nodePtr, nodeSection->size);
+		const double* x = reader.next<double>(count);
+		const double* y = reader.next<double>(count);
+		const double* z = reader.next<double>(count);
+		const double* w = reader.next<double>(count);
+		const double* h = reader.next<double>(count);
+		const quint32* type = reader.next<quint32>(count);
+		const quint32* attr = reader.next<quint32>(count);
+		const quint32* idOffsets = reader.next<quint32>(count + 1);
+		const char* ids = idOffsets ? reader.rest(idOffsets[count]) : nullptr;
+
+		if (reader.failed() || !ids)
+			return failed(QObject::tr("Broken XGR node section"));
+
+		nodes.reserve(count);
+
+		for (quint32 i = 0; i < count; ++i)
+		{
+			CItem* item = scene.createItemOfType(strings.value(type[i]));
+			CNode* node = dynamic_cast<CNode*>(item);
+			if (!node)
+			{
+				delete item;
+				return failed(QObject::tr("Unknown node type: %1").arg(QString(strings.value(type[i]))));
+			}
+
+			items << node;
+			nodes << node;
+
+			node->resize(QSizeF(w[i], h[i]));
+			node->setPos(x[i], y[i]);
+			node->setZValue(z[i]);
+
+			restoreItem(node, attr[i], ids + idOffsets[i], idOffsets[i + 1] - idOffsets[i]);
+		}
+
+		// ports
+		const XGRSection* portSection = nullptr;
+		if (const uchar* ptr = sectionData(xgrTag("PORT"), portSection))
+		{
+			QByteArray portData = sectionStream(ptr, portSection);
+			QDataStream ds(portData);
+			ds.setVersion(streamVersion);
+
+			for (quint32 i = 0; i < portSection->count; ++i)
+			{
+				quint32 nodeIndex = 0;
+				int portsCount = 0;
+				ds >> nodeIndex >> portsCount;
+
+				for (int j = 0; j < portsCount; ++j)
+				{
+					QByteArray id;
+					int align = 0;
+					double xoff = 0, yoff = 0;
+					QBrush brush;
+					QPen pen;
+					QRectF rect;
+					ds >> id >> align >> xoff >> yoff >> brush >> pen >> rect;
+
+					if (nodeIndex >= quint32(nodes.size()))
+						continue;
+
+					if (CNodePort* port = nodes[nodeIndex]->addPort(id, align, xoff, yoff))
+					{
+						port->setBrush(brush);
+						port->setPen(pen);
+						port->setRect(rect);
+						port->onParentGeometryChanged();
+					}
+				}
+			}
+		}
+	}
+
+	// edges
+	struct EdgeLink { CEdge* edge; CNode* first; CNode* last; QByteArray firstPort, lastPort; };
+	QVector<EdgeLink> links;
+
+	const XGRSection* edgeSection = nullptr;
+	const uchar* edgePtr = sectionData(xgrTag("EDGE"), edgeSection);
+
+	if (edgePtr && (m_loadParts & LoadNodes) && (m_loadParts & LoadEdges))
+	{
+		quint32 count = edgeSection->count;
+
+		XGRArrayReader reader(edgePtr, edgeSection->size);
+		const quint32* type = reader.next<quint32>(count);
+		const quint32* first = reader.next<quint32>(count);
+		const quint32* last = reader.next<quint32>(count);
+		const quint32* firstPort = reader.next<quint32>(count);
+		const quint32* lastPort = reader.next<quint32>(count);
+		const quint32* attr = reader.next<quint32>(count);
+		const quint32* idOffsets = reader.next<quint32>(count + 1);
+		const char* ids = idOffsets ? reader.rest(idOffsets[count]) : nullptr;
+
+		if (reader.failed() || !ids)
+			return failed(QObject::tr("Broken XGR edge section"));
+
+		// polyline points
+		QVector<QList<QPointF>> points(count);
+
+		const XGRSection* pointSection = nullptr;
+		if (const uchar* ptr = sectionData(xgrTag("PNTS"), pointSection))
+		{
+			quint32 polyCount = pointSection->count;
+
+			XGRArrayReader pointReader(ptr, pointSection->size);
+			const quint32* edgeIndex = pointReader.next<quint32>(polyCount);
+			const quint32* offsets = pointReader.next<quint32>(polyCount + 1);
+			const double* xy = offsets ? pointReader.next<double>(quint64(offsets[polyCount]) * 2) : nullptr;
+
+			if (pointReader.failed() || !xy)
+				return failed(QObject::tr("Broken XGR points section"));
+
+			for (quint32 i = 0; i < polyCount; ++i)
+			{
+				if (edgeIndex[i] >= count)
+					continue;
+
+				QList<QPointF>& edgePoints = points[edgeIndex[i]];
+				for (quint32 p = offsets[i]; p < offsets[i + 1]; ++p)
+					edgePoints << QPointF(xy[p * 2], xy[p * 2 + 1]);
+			}
+		}
+
+		links.reserve(count);
+
+		for (quint32 i = 0; i < count; ++i)
+		{
+			// dangling edge
+			if (first[i] >= quint32(nodes.size()) || last[i] >= quint32(nodes.size()))
+				continue;
+
+			CItem* item = scene.createItemOfType(strings.value(type[i]));
+			CEdge* edge = dynamic_cast<CEdge*>(item);
+			if (!edge)
+			{
+				delete item;
+				return failed(QObject::tr("Unknown edge type: %1").arg(QString(strings.value(type[i]))));
+			}
+
+			items << edge;
+
+			restoreItem(edge, attr[i], ids + idOffsets[i], idOffsets[i + 1] - idOffsets[i]);
+
+			if (points[i].size())
+			{
+				if (auto polyEdge = dynamic_cast<CPolyEdge*>(edge))
+					polyEdge->setPoints(points[i]);
+			}
+
+			links << EdgeLink{ edge, nodes[first[i]], nodes[last[i]], 
+				firstPort[i] == xgrNone ? QByteArray() : strings.value(firstPort[i]),
+				lastPort[i] == xgrNone ? QByteArray() : strings.value(lastPort[i]) };
+		}
+	}
+
+	// other items
+	QList<CItem*> others;
+	const XGRSection* otherSection = nullptr;
+	const uchar* otherPtr = sectionData(xgrTag("OTHR"), otherSection);
+
+	if (otherPtr && (m_loadParts & LoadOtherItems))
+	{
+		QByteArray otherData = sectionStream(otherPtr, otherSection);
+		QDataStream ds(otherData);
+		ds.setVersion(streamVersion);
+
+		for (quint32 i = 0; i < otherSection->count; ++i)
+		{
+			QByteArray typeId;
+			ds >> typeId;
+
+			CItem* item = scene.createItemOfType(typeId);
+			if (!item)
+				return failed(QObject::tr("Unknown item type: %1").arg(QString(typeId)));
+
+			items << item;
+
+			if (!item->restoreFrom(ds, storedVersion))
+				return failed(QObject::tr("Broken XGR item section"));
+
+			others << item;
+		}
+	}
+
+	// add to the scene
+	CItem::beginRestore();
+
+	for (CNode* node : nodes)
+		scene.addItem(node);
+
+	for (const EdgeLink& link : links)
+	{
+		link.edge->setFirstNode(link.first, link.firstPort);
+		link.edge->setLastNode(link.last, link.lastPort);
+		scene.addItem(link.edge);
+	}
+
+	CItem::CItemLinkMap noLinks;
+	for (CItem* item : others)
+	{
+		item->linkAfterRestore(noLinks);
+		scene.addItem(item->getSceneItem());
+	}
+
+	// class attributes, options etc.
+	const XGRSection* sceneSection = nullptr;
+	const uchar* scenePtr = sectionData(xgrTag("SCNE"), sceneSection);
+
+	if (scenePtr && (m_loadParts & LoadSettings))
+	{
+		QByteArray sceneData = sectionStream(scenePtr, sceneSection);
+		QDataStream ds(sceneData);
+		ds.setVersion(streamVersion);
+
+		scene.restoreSettingsFrom(ds, storedVersion, true);
+	}
+
+	CItem::endRestore();
+
+	for (CItem* item : items)
+		item->onItemRestored();
+
+	scene.addUndoState();
+
+	return true;
+}
+
+
+bool CFileSerializerXGR::save(const QString& fileName, CEditorScene& scene, QString* lastError) const
 {
 	QFile saveFile(fileName);
-	if (saveFile.open(QFile::WriteOnly))
+	if (!saveFile.open(QFile::WriteOnly))
 	{
-		QDataStream ds(&saveFile);
+		if (lastError)
+			*lastError = QObject::tr("%1: File cannot be opened for writing").arg(fileName);
+
+		return false;
+	}
+
 #if (QT_VERSION >= 0x050a00)
-		ds.setVersion(QDataStream::Qt_5_10);
+	const int streamVersion = QDataStream::Qt_5_10;
+#else
+	const int streamVersion = QDataStream::Qt_DefaultCompiledVersion;
 #endif
 
-		scene.storeTo(ds, true);
+	// split the items
+	QVector<CNode*> nodes;
+	QVector<CEdge*> edges;
+	QVector<CItem*> others;
+	QHash<const CNode*, quint32> nodeIndex;
+
+	// in the order of creation: same content, same file
+	for (CItem* item : scene.getRegisteredItems().orderedItems())
+	{
+		if (auto node = dynamic_cast<CNode*>(item))
+		{
+			nodeIndex[node] = nodes.size();
+			nodes << node;
+		}
+		else if (auto edge = dynamic_cast<CEdge*>(item))
+			edges << edge;
+		else
+			others << item;
+	}
+
+	XGRStringTable strings;
+
+	// local attributes
+	QByteArray attrData;
+	QDataStream attrStream(&attrData, QIODevice::WriteOnly);
+	attrStream.setVersion(streamVersion);
+
+	auto storeAttrs = [&](const CItem* item) -> quint32
+	{
+		const auto& attrs = item->getLocalAttributes();
+		if (attrs.isEmpty())
+			return xgrNone;
+
+		quint32 offset = quint32(attrStream.device()->pos());
+
+		attrStream << quint32(attrs.size());
+		for (auto it = attrs.constBegin(); it != attrs.constEnd(); ++it)
+			attrStream << strings.index(it.key()) << it.value();
+
+		return offset;
+	};
+
+	// nodes
+	QByteArray nodeData;
+	QByteArray portData;
+	quint32 portNodes = 0;
+	{
+		int count = nodes.size();
+		QVector<double> x(count), y(count), z(count), w(count), h(count);
+		QVector<quint32> type(count), attr(count);
+		QVector<QByteArray> ids(count);
+
+		QDataStream portStream(&portData, QIODevice::WriteOnly);
+		portStream.setVersion(streamVersion);
+
+		for (int i = 0; i < count; ++i)
+		{
+			const CNode* node = nodes.at(i);
+			x[i] = node->pos().x();
+			y[i] = node->pos().y();
+			z[i] = node->zValue();
+			w[i] = node->getSize().width();
+			h[i] = node->getSize().height();
+			type[i] = strings.index(node->typeId());
+			attr[i] = storeAttrs(node);
+			ids[i] = node->getId().toUtf8();
+
+			QByteArrayList portIds = node->getPortIds();
+			if (portIds.size())
+			{
+				portStream << quint32(i) << portIds.size();
+
+				for (const auto& portId : portIds)
+				{
+					const CNodePort* port = node->getPort(portId);
+					portStream << port->getId() << port->getAlign() << port->getX() << port->getY();
+					portStream << port->brush() << port->pen() << port->rect();
+				}
+
+				portNodes++;
+			}
+		}
+
+		xgrAppend(nodeData, x);
+		xgrAppend(nodeData, y);
+		xgrAppend(nodeData, z);
+		xgrAppend(nodeData, w);
+		xgrAppend(nodeData, h);
+		xgrAppend(nodeData, type);
+		xgrAppend(nodeData, attr);
+		appendIds(nodeData, ids);
+	}
+
+	// edges
+	QByteArray edgeData;
+	QByteArray pointData;
+	quint32 polyCount = 0;
+	{
+		int count = edges.size();
+		QVector<quint32> type(count), first(count), last(count), firstPort(count), lastPort(count), attr(count);
+		QVector<QByteArray> ids(count);
+
+		QVector<quint32> polyEdges, pointOffsets;
+		QVector<double> xy;
+
+		for (int i = 0; i < count; ++i)
+		{
+			const CEdge* edge = edges.at(i);
+			type[i] = strings.index(edge->typeId());
+			first[i] = nodeIndex.value(edge->firstNode(), xgrNone);
+			last[i] = nodeIndex.value(edge->lastNode(), xgrNone);
+			firstPort[i] = edge->firstPortId().isEmpty() ? xgrNone : strings.index(edge->firstPortId());
+			lastPort[i] = edge->lastPortId().isEmpty() ? xgrNone : strings.index(edge->lastPortId());
+			attr[i] = storeAttrs(edge);
+			ids[i] = edge->getId().toUtf8();
+
+			auto polyEdge = dynamic_cast<const CPolyEdge*>(edge);
+			if (polyEdge && polyEdge->getPoints().size())
+			{
+				polyEdges << i;
+				pointOffsets << xy.size() / 2;
+
+				for (const auto& p : polyEdge->getPoints())
+					xy << p.x() << p.y();
+			}
+		}
+
+		xgrAppend(edgeData, type);
+		xgrAppend(edgeData, first);
+		xgrAppend(edgeData, last);
+		xgrAppend(edgeData, firstPort);
+		xgrAppend(edgeData, lastPort);
+		xgrAppend(edgeData, attr);
+		appendIds(edgeData, ids);
+
+		polyCount = polyEdges.size();
+		if (polyCount)
+		{
+			pointOffsets << xy.size() / 2;
+
+			xgrAppend(pointData, polyEdges);
+			xgrAppend(pointData, pointOffsets);
+			xgrAppend(pointData, xy);
+		}
+	}
+
+	// other items: as in v1
+	QByteArray otherData;
+	{
+		QDataStream ds(&otherData, QIODevice::WriteOnly);
+		ds.setVersion(streamVersion);
+
+		for (CItem* item : others)
+		{
+			ds << item->typeId();
+			item->storeTo(ds, CEditorScene::storageVersion());
+		}
+	}
+
+	// scene settings
+	QByteArray sceneData;
+	{
+		QDataStream ds(&sceneData, QIODevice::WriteOnly);
+		ds.setVersion(streamVersion);
+		scene.storeSettingsTo(ds, true);
+	}
+
+	// layout
+	struct SectionData { quint32 tag; quint32 count; QByteArray* data; };
+	xgrPad(attrData);
+	xgrPad(portData);
+	xgrPad(otherData);
+	xgrPad(sceneData);
+
+	QByteArray stringData = strings.toSection();
+
+	QVector<SectionData> sectionList = {
+		{ xgrTag("STRS"), quint32(strings.count()), &stringData },
+		{ xgrTag("SCNE"), 1, &sceneData },
+		{ xgrTag("NODE"), quint32(nodes.size()), &nodeData },
+		{ xgrTag("PORT"), portNodes, &portData },
+		{ xgrTag("EDGE"), quint32(edges.size()), &edgeData },
+		{ xgrTag("PNTS"), polyCount, &pointData },
+		{ xgrTag("ATTR"), 0, &attrData },
+		{ xgrTag("OTHR"), quint32(others.size()), &otherData }
+	};
+
+	XGRHeader header;
+	memcpy(header.magic, xgrMagic, 4);
+	header.byteOrder = xgrByteOrder;
+	header.storageVersion = CEditorScene::storageVersion();
+	header.dataStreamVersion = streamVersion;
+	header.sectionsCount = sectionList.size();
+
+	QVector<XGRSection> table;
+	quint64 offset = xgrAligned(sizeof(XGRHeader) + sectionList.size() * sizeof(XGRSection));
+
+	for (const auto& sd : sectionList)
+	{
+		XGRSection section;
+		section.tag = sd.tag;
+		section.count = sd.count;
+		section.offset = offset;
+		section.size = sd.data->size();
+		table << section;
+
+		offset += section.size;
+	}
+
+	QByteArray head(reinterpret_cast<const char*>(&header), sizeof(XGRHeader));
+	head.append(reinterpret_cast<const char*>(table.constData()), int(table.size() * sizeof(XGRSection)));
+	xgrPad(head);
+
+	bool ok = (saveFile.write(head) == head.size());
 
-		return true;
+	for (const auto& sd : sectionList)
+		ok = ok && (saveFile.write(*sd.data) == sd.data->size());
+
+	if (!ok && lastError)
+		*lastError = saveFile.errorString();
+
+	return ok;
+}
+
+
+bool CFileSerializerXGR::readItemsCount(const QString& fileName, int& nodesCount, int& edgesCount)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	// header & section table only
+	XGRHeader header;
+	if (file.read(reinterpret_cast<char*>(&header), sizeof(XGRHeader)) != sizeof(XGRHeader))
+		return false;
+
+	if (memcmp(header.magic, xgrMagic, 4) != 0 || header.byteOrder != xgrByteOrder)
+		return false;
+
+	nodesCount = edgesCount = 0;
+
+	for (quint32 i = 0; i < header.sectionsCount; ++i)
+	{
+		XGRSection section;
+		if (file.read(reinterpret_cast<char*>(&section), sizeof(XGRSection)) != sizeof(XGRSection))
+			return false;
+
+		if (section.tag == xgrTag("NODE"))
+			nodesCount = section.count;
+		else if (section.tag == xgrTag("EDGE"))
+			edgesCount = section.count;
 	}
 
-	return false;
+	return true;
 }
@@ -15,10 +15,27 @@ It can be used freely, maintaining the information above.
 
 
 class CNode;
+class QFile;
 
 class CFileSerializerXGR : public IFileSerializer
 {
 public:
+	// parts of the scene to be loaded (XGR v2 only, v1 is always loaded completely)
+	enum LoadParts
+	{
+		LoadNodes = 1,
+		LoadEdges = 2,			// requires LoadNodes
+		LoadAttributes = 4,		// local attributes of the items
+		LoadSettings = 8,		// class attributes, visibility, options
+		LoadOtherItems = 16,
+		LoadAll = 0xff
+	};
+
+	CFileSerializerXGR(int loadParts = LoadAll): m_loadParts(loadParts) {}
+
+	// reads the counts from the section table only; false if not a v2 file
+	static bool readItemsCount(const QString& fileName, int& nodesCount, int& edgesCount);
+
 	// reimp
 	virtual QString description() const {
 		return "QVGE graph scene format";
@@ -43,5 +60,11 @@ public:
 	}
 
 	virtual bool save(const QString& fileName, CEditorScene& scene, QString* lastError = nullptr) const;
+
+private:
+	bool loadV1(QFile& file, CEditorScene& scene, QString* lastError) const;
+	bool loadV2(const uchar* data, qint64 size, CEditorScene& scene, QString* lastError) const;
+
+	int m_loadParts;
 };
 
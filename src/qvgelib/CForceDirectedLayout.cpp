@@ -0,0 +1,409 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include "CForceDirectedLayout.h"
+#include "CLayoutGraph.h"
+#include "CNodeEditorScene.h"
+
+#include <QVarLengthArray>
+#include <QPair>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <qmath.h>
+
+
+// coincident points are not split deeper
+static const int TREE_MAX_DEPTH = 48;
+
+// below this the thread pool costs more than it saves
+static const int THREADED_MIN_NODES = 2000;
+static const int THREADED_CHUNK = 512;
+
+static const double GOLDEN_ANGLE = 2.399963229728653;
+
+
+void CForceDirectedLayout::doLayout(CNodeEditorScene &scene) const
+{
+	CLayoutGraph graph;
+	graph.fromScene(scene);
+
+	if (graph.nodeCount() == 0)
+		return;
+
+	run(graph);
+
+	graph.toScene(scene);
+}
+
+
+void CForceDirectedLayout::run(CLayoutGraph &graph) const
+{
+	int count = graph.nodeCount();
+	if (count == 0)
+		return;
+
+	double k = m_options.edgeLength;
+
+	QRectF bounds = graph.boundingRect();
+	if (!m_options.incremental || (bounds.width() < k && bounds.height() < k && count > 1))
+		initialPlacement(graph, k);
+
+	// large steps first, then cooling down linearly
+	double startTemperature = k * (1 + qSqrt(count) * 0.05);
+	double minTemperature = k * 0.01;
+
+	for (int iter = 0; iter < m_options.iterations; ++iter)
+	{
+		double t = qMax(minTemperature, startTemperature * (1.0 - double(iter) / m_options.iterations));
+
+		double maxDisplacement = step(graph, t);
+		if (maxDisplacement < k * 0.001)
+			break;
+	}
+
+	// the far field repulsion inflates big graphs: back to the desired scale
+	scaleToEdgeLength(graph, k);
+}
+
+
+void CForceDirectedLayout::scaleToEdgeLength(CLayoutGraph &graph, double edgeLength)
+{
+	int count = graph.nodeCount();
+	if (count < 2 || graph.targets.isEmpty())
+		return;
+
+	double sum = 0;
+	double centerX = 0, centerY = 0;
+
+	for (int i = 0; i < count; ++i)
+	{
+		centerX += graph.x[i];
+		centerY += graph.y[i];
+
+		for (int e = graph.offsets[i]; e < graph.offsets[i + 1]; ++e)
+		{
+			int j = graph.targets[e];
+			double dx = graph.x[j] - graph.x[i];
+			double dy = graph.y[j] - graph.y[i];
+			sum += qSqrt(dx * dx + dy * dy);
+		}
+	}
+
+	double meanLength = sum / graph.targets.size();
+	if (meanLength <= 0)
+		return;
+
+	centerX /= count;
+	centerY /= count;
+
+	double scale = edgeLength / meanLength;
+
+	// long hub edges: keep at least half of the edge length between the nodes anyway
+	QRectF bounds = graph.boundingRect();
+	double spacing = qSqrt(bounds.width() * bounds.height() / count);
+	if (spacing > 0)
+		scale = qMax(scale, edgeLength * 0.5 / spacing);
+
+	for (int i = 0; i < count; ++i)
+	{
+		graph.x[i] = centerX + (graph.x[i] - centerX) * scale;
+		graph.y[i] = centerY + (graph.y[i] - centerY) * scale;
+	}
+}
+
+
+void CForceDirectedLayout::initialPlacement(CLayoutGraph &graph, double edgeLength)
+{
+	int count = graph.nodeCount();
+
+	// breadth-first order: the neighbours start close to each other
+	QVector<int> order;
+	order.reserve(count);
+	QVector<bool> visited(count, false);
+
+	for (int root = 0; root < count; ++root)
+	{
+		if (visited[root])
+			continue;
+
+		visited[root] = true;
+		order << root;
+
+		for (int head = order.size() - 1; head < order.size(); ++head)
+		{
+			int i = order[head];
+			for (int e = graph.offsets[i]; e < graph.offsets[i + 1]; ++e)
+			{
+				int j = graph.targets[e];
+				if (!visited[j])
+				{
+					visited[j] = true;
+					order << j;
+				}
+			}
+		}
+	}
+
+	// sunflower spiral: even density, about edgeLength between the nodes
+	double c = edgeLength * 0.5;
+
+	for (int n = 0; n < count; ++n)
+	{
+		int i = order[n];
+		double r = c * qSqrt(n);
+		double a = n * GOLDEN_ANGLE;
+		graph.x[i] = r * qCos(a);
+		graph.y[i] = r * qSin(a);
+	}
+}
+
+
+double CForceDirectedLayout::step(CLayoutGraph &graph, double temperature) const
+{
+	int count = graph.nodeCount();
+	if (count == 0)
+		return 0;
+
+	QVector<Cell> cells;
+	buildTree(graph, cells);
+
+	// the root holds the center of mass
+	double centerX = cells[0].cx;
+	double centerY = cells[0].cy;
+
+	QVector<double> fx(count, 0.0), fy(count, 0.0);
+	double *forcesX = fx.data();
+	double *forcesY = fy.data();
+
+	if (m_options.threaded && count >= THREADED_MIN_NODES)
+	{
+		QVector<QPair<int, int>> ranges;
+		for (int first = 0; first < count; first += THREADED_CHUNK)
+			ranges << qMakePair(first, qMin(first + THREADED_CHUNK, count));
+
+		// every chunk writes its own slice of fx & fy
+		QtConcurrent::blockingMap(ranges, [&](QPair<int, int> &range)
+		{
+			computeForces(graph, cells, centerX, centerY, range.first, range.second, forcesX, forcesY);
+		});
+	}
+	else
+		computeForces(graph, cells, centerX, centerY, 0, count, forcesX, forcesY);
+
+	// move, limited by the temperature
+	double maxDisplacement = 0;
+	double *px = graph.x.data();
+	double *py = graph.y.data();
+	const double *pfx = fx.constData();
+	const double *pfy = fy.constData();
+
+	for (int i = 0; i < count; ++i)
+	{
+		double f = qSqrt(pfx[i] * pfx[i] + pfy[i] * pfy[i]);
+		if (f <= 0)
+			continue;
+
+		double d = qMin(f, temperature);
+		double s = d / f;
+		px[i] += pfx[i] * s;
+		py[i] += pfy[i] * s;
+
+		maxDisplacement = qMax(maxDisplacement, d);
+	}
+
+	return maxDisplacement;
+}
+
+
+void CForceDirectedLayout::buildTree(const CLayoutGraph &graph, QVector<Cell> &cells) const
+{
+	int count = graph.nodeCount();
+
+	QRectF bounds = graph.boundingRect();
+
+	cells.clear();
+	cells.reserve(count * 3 + 1);
+
+	// square root cell, a bit larger to keep the borders inside
+	Cell root;
+	root.size = qMax(bounds.width(), bounds.height()) + 1;
+	root.x0 = bounds.center().x() - root.size / 2;
+	root.y0 = bounds.center().y() - root.size / 2;
+	cells << root;
+
+	for (int i = 0; i < count; ++i)
+	{
+		double px = graph.x[i], py = graph.y[i];
+
+		int c = 0;
+		for (int depth = 0; ; ++depth)
+		{
+			if (cells[c].firstChild < 0)
+			{
+				Cell &leaf = cells[c];
+
+				// empty leaf: take it
+				if (leaf.body < 0)
+				{
+					leaf.body = i;
+					leaf.mass = 1;
+					leaf.cx = px;
+					leaf.cy = py;
+					break;
+				}
+
+				// too deep: all the coincident bodies are in one leaf
+				if (depth >= TREE_MAX_DEPTH)
+				{
+					leaf.mass += 1;
+					leaf.cx += px;
+					leaf.cy += py;
+					break;
+				}
+
+				// split: the body goes down
+				int body = leaf.body;
+				double half = leaf.size / 2;
+				double x0 = leaf.x0, y0 = leaf.y0;
+
+				leaf.body = -1;
+				leaf.firstChild = cells.size();
+
+				for (int q = 0; q < 4; ++q)
+				{
+					Cell child;
+					child.size = half;
+					child.x0 = x0 + (q & 1) * half;
+					child.y0 = y0 + (q >> 1) * half;
+					cells << child;
+				}
+
+				double bx = graph.x[body], by = graph.y[body];
+				int bq = (bx >= x0 + half ? 1 : 0) | (by >= y0 + half ? 2 : 0);
+
+				Cell &bodyCell = cells[cells[c].firstChild + bq];
+				bodyCell.body = body;
+				bodyCell.mass = 1;
+				bodyCell.cx = bx;
+				bodyCell.cy = by;
+			}
+
+			// inner cell: accumulate & descend
+			Cell &cell = cells[c];
+			cell.mass += 1;
+			cell.cx += px;
+			cell.cy += py;
+
+			double half = cell.size / 2;
+			int q = (px >= cell.x0 + half ? 1 : 0) | (py >= cell.y0 + half ? 2 : 0);
+			c = cell.firstChild + q;
+		}
+	}
+
+	// sums -> centers of mass
+	for (Cell &cell : cells)
+	{
+		if (cell.mass > 0)
+		{
+			cell.cx /= cell.mass;
+			cell.cy /= cell.mass;
+		}
+	}
+}
+
+
+void CForceDirectedLayout::computeForces(const CLayoutGraph &graph, const QVector<Cell> &cells,
+	double centerX, double centerY, int first, int last,
+	double *fx, double *fy) const
+{
+	const double k = m_options.edgeLength;
+	const double k2 = k * k;
+	const double theta2 = m_options.theta * m_options.theta;
+	const double minDistance = k * 0.001;
+
+	const double *xs = graph.x.constData();
+	const double *ys = graph.y.constData();
+	const Cell *tree = cells.constData();
+
+	QVarLengthArray<int, 256> stack;
+
+	for (int i = first; i < last; ++i)
+	{
+		double px = xs[i], py = ys[i];
+		double fxi = 0, fyi = 0;
+
+		// repulsion: k^2 / d from every other body, far cells as a whole
+		stack.clear();
+		stack.append(0);
+
+		while (!stack.isEmpty())
+		{
+			const Cell &cell = tree[stack.last()];
+			stack.removeLast();
+
+			if (cell.mass <= 0)
+				continue;
+
+			double m = cell.mass;
+			double dx = px - cell.cx;
+			double dy = py - cell.cy;
+			double d2 = dx * dx + dy * dy;
+
+			if (cell.firstChild >= 0)
+			{
+				// never approximate the cell of the body itself
+				bool inside = (px >= cell.x0 && px < cell.x0 + cell.size && py >= cell.y0 && py < cell.y0 + cell.size);
+				if (inside || cell.size * cell.size >= theta2 * d2)
+				{
+					for (int q = 0; q < 4; ++q)
+						stack.append(cell.firstChild + q);
+					continue;
+				}
+			}
+			else if (cell.body == i)
+			{
+				// the coincident others only
+				m -= 1;
+				if (m <= 0)
+					continue;
+			}
+
+			// same place: push apart in a stable direction
+			if (d2 < minDistance * minDistance)
+			{
+				double a = i * GOLDEN_ANGLE;
+				dx = minDistance * qCos(a);
+				dy = minDistance * qSin(a);
+				d2 = minDistance * minDistance;
+			}
+
+			double f = k2 * m / d2;
+			fxi += dx * f;
+			fyi += dy * f;
+		}
+
+		// attraction: d^2 / k along the edges
+		for (int e = graph.offsets[i]; e < graph.offsets[i + 1]; ++e)
+		{
+			int j = graph.targets[e];
+			double dx = xs[j] - px;
+			double dy = ys[j] - py;
+			double f = qSqrt(dx * dx + dy * dy) / k;
+			fxi += dx * f;
+			fyi += dy * f;
+		}
+
+		// gravity
+		fxi += (centerX - px) * m_options.gravity;
+		fyi += (centerY - py) * m_options.gravity;
+
+		fx[i] = fxi;
+		fy[i] = fyi;
+	}
+}
@@ -0,0 +1,78 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QVector>
+
+class CLayoutGraph;
+class CNodeEditorScene;
+
+
+// Native spring-electrical layout (Fruchterman-Reingold forces).
+// The repulsion is approximated via a Barnes-Hut quadtree, so an iteration is O(N log N);
+// the forces of the nodes are computed in parallel, the tree is rebuilt once per iteration.
+
+class CForceDirectedLayout
+{
+public:
+	struct Options
+	{
+		int iterations = 300;
+		// desired edge length
+		double edgeLength = 100;
+		// Barnes-Hut opening criterion: cell size / distance
+		double theta = 0.9;
+		// pull towards the center, keeps the components together
+		double gravity = 1.0;
+		// start from the current positions, else from scratch
+		bool incremental = false;
+		bool threaded = true;
+	};
+
+	void setOptions(const Options &options)		{ m_options = options; }
+	const Options& getOptions() const			{ return m_options; }
+
+	// lays out the snapshot in place
+	void run(CLayoutGraph &graph) const;
+
+	// lays out the nodes of the scene: snapshot, run, write back as one undo step
+	void doLayout(CNodeEditorScene &scene) const;
+
+	// spirals the nodes around the origin, no overlaps
+	static void initialPlacement(CLayoutGraph &graph, double edgeLength);
+
+	// scales the positions around the center to the given mean edge length (but not denser than edgeLength / 2)
+	static void scaleToEdgeLength(CLayoutGraph &graph, double edgeLength);
+
+	// one pass of the forces with the given step limit, returns the max displacement
+	double step(CLayoutGraph &graph, double temperature) const;
+
+private:
+	struct Cell
+	{
+		// center of mass (sum of positions while building)
+		double cx = 0, cy = 0;
+		double mass = 0;
+		// square bounds
+		double x0 = 0, y0 = 0, size = 0;
+		// 4 consecutive children or -1
+		int firstChild = -1;
+		// single body of a leaf or -1
+		int body = -1;
+	};
+
+	void buildTree(const CLayoutGraph &graph, QVector<Cell> &cells) const;
+
+	void computeForces(const CLayoutGraph &graph, const QVector<Cell> &cells,
+		double centerX, double centerY, int first, int last,
+		double *fx, double *fy) const;
+
+	Options m_options;
+};
@@ -118,12 +118,7 @@ QList<CEdge*> CGraphInterface::getEdges() const
     QList<CEdge*> edges;
 
     if (m_scene)
-    {
-        auto items = m_scene->items();
-        for (auto item: items)
-            if (auto edge = dynamic_cast<CEdge*>(item))
-                edges << edge;
-    }
+        edges = m_scene->getEdges().toList();
 
     return edges;
 }
@@ -134,12 +129,7 @@ QList<CNode*> CGraphInterface::getNodes() const
     QList<CNode*> nodes;
 
     if (m_scene)
-    {
-        auto items = m_scene->items();
-        for (auto item: items)
-            if (auto node = dynamic_cast<CNode*>(item))
-                nodes << node;
-    }
+        nodes = m_scene->getNodes().toList();
 
     return nodes;
 }
@@ -13,7 +13,14 @@ It can be used freely, maintaining the information above.
 #include <QMap>
 #include <QByteArray>
 #include <QSet>
-#include <QScopedPointer>
+#include <QPicture>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <limits>
 
 #include "CImageExport.h"
 #include "CEditorScene.h"
@@ -86,40 +93,287 @@ QString CImageExport::filters() const
 }
 
 
-bool CImageExport::save(const QString& fileName, CEditorScene& scene, QString* /*lastError*/) const
+// tiled rendering: the scene is recorded once, then the bands of the target image are
+// painted from the recording in parallel. TIFF is written band by band (one strip each),
+// so memory does not depend on the image size.
+
+struct ImageBand
+{
+	int top = 0;
+	int height = 0;
+	QImage image;
+	QByteArray strip;		// compressed RGB rows (TIFF only)
+};
+
+
+static void renderBand(ImageBand& band, const QByteArray& pictureData, int width, uchar* bits = nullptr, int bytesPerLine = 0)
+{
+	// own copy: QPicture playback is not reentrant
+	QPicture picture;
+	picture.setData(pictureData.constData(), pictureData.size());
+
+	if (bits)
+		band.image = QImage(bits + qint64(band.top) * bytesPerLine, width, band.height, bytesPerLine, QImage::Format_ARGB32);
+	else
+		band.image = QImage(width, band.height, QImage::Format_RGB32);
+
+	band.image.fill(Qt::white);
+
+	QPainter painter(&band.image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	painter.setRenderHint(QPainter::TextAntialiasing);
+	painter.translate(0, -band.top);
+	painter.drawPicture(0, 0, picture);
+	painter.end();
+}
+
+
+static void compressBand(ImageBand& band)
 {
-	QScopedPointer<CEditorScene> tempScene(scene.clone());
+	int width = band.image.width();
+
+	QByteArray rgb;
+	rgb.resize(width * band.height * 3);
+	uchar* dest = (uchar*)rgb.data();
+
+	for (int y = 0; y < band.height; ++y)
+	{
+		const QRgb* line = (const QRgb*)band.image.constScanLine(y);
+		for (int x = 0; x < width; ++x)
+		{
+			*dest++ = qRed(line[x]);
+			*dest++ = qGreen(line[x]);
+			*dest++ = qBlue(line[x]);
+		}
+	}
+
+	band.image = QImage();
+
+	// zlib stream without the size prefix of qCompress
+	band.strip = qCompress(rgb, 6).mid(4);
+}
+
+
+// baseline TIFF, RGB, deflate compressed strips
+
+class CTiffStreamWriter
+{
+public:
+	CTiffStreamWriter(QFile& file): m_file(file) {}
+
+	bool begin()
+	{
+		static const char header[8] = { 'I', 'I', 42, 0, 0, 0, 0, 0 };	// IFD offset: set at the end
+		return m_file.write(header, 8) == 8;
+	}
+
+	bool writeStrip(const QByteArray& strip)
+	{
+		if (m_file.pos() + strip.size() > 0xffffffffLL)
+			return false;
+
+		m_offsets << quint32(m_file.pos());
+		m_counts << quint32(strip.size());
+		return m_file.write(strip) == strip.size();
+	}
+
+	bool end(int width, int height, int rowsPerStrip, int dpi)
+	{
+		QByteArray data;
+		QDataStream ds(&data, QIODevice::WriteOnly);
+		ds.setByteOrder(QDataStream::LittleEndian);
+
+		// the strips have any length: the values & the IFD must start on a word boundary
+		if ((m_file.pos() & 1) && m_file.write("\0", 1) != 1)
+			return false;
+
+		quint32 base = quint32(m_file.pos());
+		int stripsCount = m_offsets.size();
+
+		// out of line values
+		quint32 bitsOffset = base;
+		ds << quint16(8) << quint16(8) << quint16(8) << quint16(0);
+
+		quint32 resOffset = base + data.size();
+		ds << quint32(qMax(dpi, 1)) << quint32(1);
+
+		quint32 stripOffsetsOffset = base + data.size();
+		for (quint32 v : m_offsets)
+			ds << v;
+
+		quint32 stripCountsOffset = base + data.size();
+		for (quint32 v : m_counts)
+			ds << v;
+
+		// words only: still aligned
+		quint32 ifdOffset = base + data.size();
+
+		// IFD: tags in ascending order
+		const quint16 SHORT = 3, LONG = 4, RATIONAL = 5;
+		ds << quint16(13);
+
+		auto entry = [&](quint16 tag, quint16 type, quint32 count, quint32 value)
+		{
+			ds << tag << type << count;
+			if (type == SHORT && count == 1)
+				ds << quint16(value) << quint16(0);
+			else
+				ds << value;
+		};
+
+		entry(256, LONG, 1, width);
+		entry(257, LONG, 1, height);
+		entry(258, SHORT, 3, bitsOffset);
+		entry(259, SHORT, 1, 8);				// deflate
+		entry(262, SHORT, 1, 2);				// RGB
+		entry(273, LONG, stripsCount, stripsCount == 1 ? m_offsets.first() : stripOffsetsOffset);
+		entry(277, SHORT, 1, 3);
+		entry(278, LONG, 1, rowsPerStrip);
+		entry(279, LONG, stripsCount, stripsCount == 1 ? m_counts.first() : stripCountsOffset);
+		entry(282, RATIONAL, 1, resOffset);
+		entry(283, RATIONAL, 1, resOffset);
+		entry(284, SHORT, 1, 1);				// chunky
+		entry(296, SHORT, 1, 2);				// inch
+
+		ds << quint32(0);						// no more IFDs
+
+		if (m_file.pos() + data.size() > 0xffffffffLL || m_file.write(data) != data.size())
+			return false;
+
+		// patch the header
+		QByteArray offset;
+		QDataStream os(&offset, QIODevice::WriteOnly);
+		os.setByteOrder(QDataStream::LittleEndian);
+		os << ifdOffset;
+
+		return m_file.seek(4) && m_file.write(offset) == 4;
+	}
+
+private:
+	QFile& m_file;
+	QVector<quint32> m_offsets, m_counts;
+};
+
 
-	if (m_cutContent)
-		tempScene->crop();
+bool CImageExport::save(const QString& fileName, CEditorScene& scene, QString* lastError) const
+{
+	CEditorScene::RenderOptions options;
+	options.cropToContent = m_cutContent;
 
-	QImage image(tempScene->sceneRect().size().toSize(), QImage::Format_ARGB32);
-	QRect targetRect;	// empty by default
+	QRectF sourceRect = scene.getRenderRect(options);
+	QSize targetSize = sourceRect.size().toSize();
 
 	// resolution
-	int old_dpi = image.physicalDpiX();
+	int old_dpi = QImage(1, 1, QImage::Format_RGB32).physicalDpiX();
 	if (old_dpi <= 0)
 		old_dpi = 96;
 
+	int dpi = old_dpi;
+
 	if (m_resolution > 0 && old_dpi != m_resolution)
 	{
 		double coeff = (double)m_resolution / (double)old_dpi;
-		int dpm = m_resolution / 0.0254;
-		image.setDotsPerMeterX(dpm);
-		image.setDotsPerMeterY(dpm);
+		targetSize = targetSize * coeff;
+		dpi = m_resolution;
+	}
 
-		QSize newSize = image.size() * coeff;
-		image = image.scaled(newSize);
+	if (targetSize.isEmpty())
+		return false;
 
-		targetRect = QRect(0,0, newSize.width(), newSize.height());
+	// record the scene once
+	QPicture picture;
+	QPainter recorder(&picture);
+	recorder.setRenderHint(QPainter::Antialiasing);
+	recorder.setRenderHint(QPainter::TextAntialiasing);
+	scene.renderScene(&recorder, QRectF(QPointF(0, 0), targetSize), options);
+	recorder.end();
+
+	QByteArray pictureData(picture.data(), int(picture.size()));
+
+	// bands of up to 32 MB, rendered by as many threads as there are cores
+	const int width = targetSize.width();
+	const int height = targetSize.height();
+	const int bandHeight = qBound(16, int((32 << 20) / (qint64(width) * 4)), 1024);
+	const int batchSize = qMax(1, QThread::idealThreadCount());
+
+	QVector<ImageBand> bands;
+	for (int top = 0; top < height; top += bandHeight)
+	{
+		ImageBand band;
+		band.top = top;
+		band.height = qMin(bandHeight, height - top);
+		bands << band;
 	}
 
-	image.fill(Qt::white);
-	QPainter painter(&image);
-	painter.setRenderHint(QPainter::Antialiasing);
-	painter.setRenderHint(QPainter::TextAntialiasing);
-	tempScene->render(&painter, targetRect);
-	painter.end();
+	QString suffix = QFileInfo(fileName).suffix().toLower();
+	bool ok = false;
+
+	if (suffix == "tif" || suffix == "tiff")
+	{
+		QFile file(fileName);
+		if (!file.open(QFile::WriteOnly))
+		{
+			if (lastError)
+				*lastError = QObject::tr("%1: File cannot be opened for writing").arg(fileName);
+
+			return false;
+		}
+
+		CTiffStreamWriter tiff(file);
+		ok = tiff.begin();
+
+		for (int i = 0; ok && i < bands.size(); i += batchSize)
+		{
+			QVector<ImageBand> batch = bands.mid(i, batchSize);
+
+			QtConcurrent::blockingMap(batch, [&](ImageBand& band)
+			{
+				renderBand(band, pictureData, width);
+				compressBand(band);
+			});
+
+			for (const ImageBand& band : batch)
+				ok = ok && tiff.writeStrip(band.strip);
+		}
+
+		ok = ok && tiff.end(width, height, bandHeight, dpi);
+
+		if (!ok && lastError)
+			*lastError = QObject::tr("%1: TIFF image cannot be written (more than 4 GB?)").arg(fileName);
+	}
+	else
+	{
+		// other formats: one image, the bands are painted into it in place
+		if (qint64(width) * height * 4 > std::numeric_limits<int>::max())
+		{
+			if (lastError)
+				*lastError = QObject::tr("Image of %1x%2 pixels is too large for this format, please use TIFF").arg(width).arg(height);
+
+			return false;
+		}
+
+		QImage image(targetSize, QImage::Format_ARGB32);
+		if (image.isNull())
+			return false;
+
+		if (dpi != old_dpi)
+		{
+			int dpm = dpi / 0.0254;
+			image.setDotsPerMeterX(dpm);
+			image.setDotsPerMeterY(dpm);
+		}
+
+		uchar* bits = image.bits();
+		int bytesPerLine = image.bytesPerLine();
+
+		QtConcurrent::blockingMap(bands, [&](ImageBand& band)
+		{
+			renderBand(band, pictureData, width, bits, bytesPerLine);
+			band.image = QImage();
+		});
+
+		ok = image.save(fileName);
+	}
 
-	return image.save(fileName);
+	return ok;
 }
@@ -18,21 +18,33 @@ It can be used freely, maintaining the information above.
 bool CItem::s_duringRestore = false;
 
 
+// label
+
+void CItemLabel::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+	// unreadable anyway
+	if (option->levelOfDetailFromTransform(painter->worldTransform()) < LOD_Labels)
+		return;
+
+	QGraphicsSimpleTextItem::paint(painter, option, widget);
+}
+
+
 CItem::CItem()
 {
 	m_labelItem = NULL;
 
 	// default item flags
 	m_itemFlags = IF_DeleteAllowed | IF_FramelessSelection;
-	m_internalStateFlags = IS_Attribute_Changed | IS_Need_Update;
+	m_internalStateFlags = IS_Attribute_Changed | IS_Need_Update | IS_Style_Changed;
 }
 
 
 CItem::~CItem()
 {
-	CEditorScene *scene = getScene();
-	if (scene)
-		scene->onItemDestroyed(this);
+	// getScene() cannot be used here since the graphics part is already destroyed
+	if (m_attachedScene)
+		m_attachedScene->onItemDestroyed(this);
 }
 
 
@@ -90,26 +102,57 @@ bool CItem::hasLocalAttribute(const QByteArray& attrId) const
 
 bool CItem::setAttribute(const QByteArray& attrId, const QVariant& v)
 {
-	setItemStateFlag(IS_Attribute_Changed);
+	setItemStateFlag(IS_Attribute_Changed | IS_Style_Changed);
+
+	if (auto tracker = getChangeTracker())
+	{
+		QVariant oldValue = (attrId == "id") ? QVariant(m_id) : m_attributes.value(attrId);
+		tracker->onItemAttributeChanged(this, attrId, oldValue, v);
+	}
 
 	if (attrId == "id")
 	{
+		QString oldId = m_id;
 		m_id = v.toString();
+
+		if (m_attachedScene && oldId != m_id)
+		{
+			m_attachedScene->onItemIdChanged(this, oldId);
+			m_attachedScene->onItemAttributeChanged(this, attrId);
+		}
+
+		invalidateLabelLayout();
 		return true;
 	}
 
 	// real attributes
 	m_attributes[attrId] = v;
 
+	if (m_attachedScene)
+		m_attachedScene->onItemAttributeChanged(this, attrId);
+
+	invalidateLabelLayout();
+
 	return true;
 }
 
 
 bool CItem::removeAttribute(const QByteArray& attrId)
 {
+	if (auto tracker = getChangeTracker())
+	{
+		if (m_attributes.contains(attrId))
+			tracker->onItemAttributeChanged(this, attrId, m_attributes[attrId], QVariant());
+	}
+
 	if (m_attributes.remove(attrId))
 	{
-		setItemStateFlag(IS_Attribute_Changed);
+		setItemStateFlag(IS_Attribute_Changed | IS_Style_Changed);
+
+		if (m_attachedScene)
+			m_attachedScene->onItemAttributeChanged(this, attrId);
+
+		invalidateLabelLayout();
 		return true;
 	}
 	else
@@ -122,16 +165,37 @@ QVariant CItem::getAttribute(const QByteArray& attrId) const
 	if (attrId == "id")
 		return m_id;
 
-	if (m_attributes.contains(attrId))
-		return m_attributes[attrId];
+	auto it = m_attributes.constFind(attrId);
+	if (it != m_attributes.constEnd())
+		return *it;
 
-	if (auto scene = getScene())
-		return scene->getClassAttribute(classId(), attrId, true).defaultValue;
+	if (auto attr = getClassAttribute(attrId))
+		return attr->defaultValue;
 
 	return QVariant();
 }
 
 
+const CAttribute* CItem::getClassAttribute(const QByteArray& attrId) const
+{
+	if (!m_attachedScene)
+		return nullptr;
+
+	// re-resolve the class table only if the class attributes were changed
+	if (!m_classAttributesCache || m_classAttributesVersion != m_attachedScene->getClassAttributesVersion())
+	{
+		m_classAttributesCache = &m_attachedScene->getResolvedClassAttributes(classId());
+		m_classAttributesVersion = m_attachedScene->getClassAttributesVersion();
+	}
+
+	auto it = m_classAttributesCache->constFind(attrId);
+	if (it == m_classAttributesCache->constEnd())
+		return nullptr;
+
+	return &(*it);
+}
+
+
 QSet<QByteArray> CItem::getVisibleAttributeIds(int flags) const
 {
 	QSet<QByteArray> result;
@@ -177,6 +241,15 @@ CEditorScene* CItem::getScene() const
 }
 
 
+bool CItem::isSelectionPainted(const QStyleOptionGraphicsItem *option) const
+{
+	if (!(option->state & QStyle::State_Selected))
+		return false;
+
+	return !(m_attachedScene && m_attachedScene->isSelectionHidden());
+}
+
+
 void CItem::addUndoState()
 {
 	if (auto scene = getScene())
@@ -184,6 +257,41 @@ void CItem::addUndoState()
 }
 
 
+// change tracking
+
+IUndoManager* CItem::getChangeTracker() const
+{
+	if (s_duringRestore || !m_attachedScene)
+		return nullptr;
+
+	return m_attachedScene->getChangeTracker();
+}
+
+
+void CItem::invalidateLabelLayout()
+{
+	if (m_attachedScene)
+		m_attachedScene->invalidateItemLabel(this);
+}
+
+
+void CItem::updateSceneAttachment()
+{
+	CEditorScene *scene = getScene();
+	if (scene == m_attachedScene)
+		return;
+
+	if (m_attachedScene)
+		m_attachedScene->onItemRemoved(this);
+
+	m_attachedScene = scene;
+	m_classAttributesCache = nullptr;
+
+	if (m_attachedScene)
+		m_attachedScene->onItemAdded(this);
+}
+
+
 // cloning
 
 void CItem::copyDataFrom(CItem* from)
@@ -258,9 +366,11 @@ void CItem::updateLabelContent()
 
 
     // label attrs
-	m_labelItem->setBrush(getAttribute(attr_label_color).value<QColor>());
+	checkStyle();
+
+	m_labelItem->setBrush(m_style.labelColor);
 	
-	QFont f(getAttribute(attr_label_font).value<QFont>());
+	QFont f(m_style.labelFont);
 
 	if (!scene->isFontAntialiased())
 		f.setStyleStrategy(QFont::NoAntialias);
@@ -385,6 +495,8 @@ void CItem::updateCachedItems()
 {
 	setItemStateFlag(IS_Attribute_Changed);
 
+	checkStyle();
+
 	// update text label
 	if (getScene() && getScene()->itemLabelsEnabled())
 	{
@@ -393,3 +505,33 @@ void CItem::updateCachedItems()
 		updateLabelDecoration();
 	}
 }
+
+
+// paint style
+
+const CItemStyle& CItem::getStyle()
+{
+	checkStyle();
+
+	return m_style;
+}
+
+
+void CItem::checkStyle()
+{
+	quint64 classVersion = m_attachedScene ? m_attachedScene->getClassAttributesVersion() : 0;
+
+	if ((m_internalStateFlags & IS_Style_Changed) || m_style.classVersion != classVersion)
+		updateStyle();
+}
+
+
+void CItem::updateStyle()
+{
+	resetItemStateFlag(IS_Style_Changed);
+
+	m_style.classVersion = m_attachedScene ? m_attachedScene->getClassAttributesVersion() : 0;
+
+	m_style.labelColor = getAttribute(attr_label_color).value<QColor>();
+	m_style.labelFont = getAttribute(attr_label_font).value<QFont>();
+}
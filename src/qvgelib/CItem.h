@@ -19,6 +19,7 @@ It can be used freely, maintaining the information above.
 #include "Properties.h"
 #include "CUtils.h"
 #include "IInteractive.h"
+#include "IUndoManager.h"
 
 
 enum ItemFlags
@@ -37,13 +38,43 @@ enum ItemStateFlags
 	IS_Drag_Accepted = 4,
 	IS_Drag_Rejected = 8,
 	IS_Attribute_Changed = 16,
-	IS_Need_Update = 32
+	IS_Need_Update = 32,
+	IS_Style_Changed = 64
 };
 
 
+// level of detail thresholds (QStyleOptionGraphicsItem::levelOfDetailFromTransform)
+const qreal LOD_Simplified = 0.3;	// below: nodes as filled rects, edges as hairlines
+const qreal LOD_Labels = 0.5;		// below: labels are not drawn
+
+
 class CControlPoint;
 
 
+// item label: skipped when zoomed out
+
+class CItemLabel : public QGraphicsSimpleTextItem
+{
+public:
+	explicit CItemLabel(QGraphicsItem *parent) : QGraphicsSimpleTextItem(parent) {}
+
+	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+};
+
+
+// paint style resolved from the attributes
+struct CItemStyle
+{
+	QBrush brush;
+	QPen pen;
+	QColor labelColor;
+	QFont labelFont;
+
+	// class attributes version the style was built with
+	quint64 classVersion = 0;
+};
+
+
 class Stub
 {
 public:
@@ -86,6 +117,9 @@ public:
 	virtual bool removeAttribute(const QByteArray& attrId);
 	virtual QVariant getAttribute(const QByteArray& attrId) const;
 
+	// class default of the attribute (inheritance resolved), nullptr if none
+	const CAttribute* getClassAttribute(const QByteArray& attrId) const;
+
 	virtual QByteArray classId() const { return "item"; }
 	virtual QByteArray superClassId() const { return QByteArray(); }
 
@@ -122,9 +156,13 @@ public:
 	virtual bool storeTo(QDataStream& out, quint64 version64) const;
 	virtual bool restoreFrom(QDataStream& out, quint64 version64);
 
+	// sets the stored state directly (no change tracking), i.e. for columnar file formats
+	void restoreAttributes(const QMap<QByteArray, QVariant>& attrs, const QString& id) { m_attributes = attrs; m_id = id; }
+
 	typedef QMap<quint64, CItem*> CItemLinkMap;
 	virtual bool linkAfterRestore(const CItemLinkMap& /*idToItem*/) { return true; }
 	virtual bool linkAfterPaste(const CItemLinkMap& idToItem) { return linkAfterRestore(idToItem); }	// default the same
+	virtual QList<CItem*> getLinkedItems() const { return QList<CItem*>(); }	// items this one depends on
 	static void beginRestore() { s_duringRestore = true; }
 	static void endRestore() { s_duringRestore = false; }
 
@@ -150,6 +188,24 @@ public:
 	// called after restoring data (reimplement to update cached attribute values)
 	virtual void updateCachedItems();
 
+	// cached paint style (rebuilt if attributes or class defaults have been changed)
+	const CItemStyle& getStyle();
+
+	// selection state to paint: off while the scene renders without the selection
+	bool isSelectionPainted(const QStyleOptionGraphicsItem *option) const;
+
+protected:
+	// change tracking (undo)
+	IUndoManager* getChangeTracker() const;
+	void updateSceneAttachment();
+
+	// asks the scene to re-layout the label of this item
+	void invalidateLabelLayout();
+
+	// paint style
+	void checkStyle();
+	virtual void updateStyle();
+
 protected:
 	int m_itemFlags;
 	int m_internalStateFlags;
@@ -157,6 +213,15 @@ protected:
 	QString m_id;
 	QGraphicsSimpleTextItem *m_labelItem;
 
+	// scene which has been notified about this item
+	CEditorScene *m_attachedScene = nullptr;
+
+	CItemStyle m_style;
+
+	// resolved class attributes of the attached scene
+	mutable const CEditorScene::ResolvedAttributes *m_classAttributesCache = nullptr;
+	mutable quint64 m_classAttributesVersion = 0;
+
 	// restore optimization
 	static bool s_duringRestore;
 };
@@ -172,18 +237,7 @@ QString CItem::createUniqueId(const QString& tmpl) const
 		return tmpl.arg(++count);
 	}
 
-	auto citems = editorScene->getItems<C>();
-	QSet<QString> ids;
-	for (const auto &citem : citems)
-		ids << citem->getId();
-
-	int count = 0;
-	QString newId;
-	do
-		newId = tmpl.arg(++count);
-	while (ids.contains(newId));
-
-	return newId;
+	return editorScene->createUniqueId<C>(tmpl);
 };
 
 
@@ -0,0 +1,115 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QtCore/QVector>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+
+#include <algorithm>
+
+
+// Registry of the scene items of one type.
+// Items are registered by a handle (the pointer the scene is notified with),
+// so they can be unregistered when only the base part is still alive.
+// Adding & removing is O(1), removal moves the last item into the freed slot,
+// so the iteration order depends on the removals: orderedItems() gives the order of adding.
+
+template<class T>
+class CItemRegistry
+{
+public:
+	typedef typename QVector<T*>::const_iterator const_iterator;
+
+	// zero-copy iteration
+	const_iterator begin() const	{ return m_items.constBegin(); }
+	const_iterator end() const		{ return m_items.constEnd(); }
+
+	int size() const				{ return m_items.size(); }
+	int count() const				{ return m_items.size(); }
+	bool isEmpty() const			{ return m_items.isEmpty(); }
+	T* at(int index) const			{ return m_items.at(index); }
+
+	const QVector<T*>& items() const	{ return m_items; }
+	QList<T*> toList() const			{ return m_items.toList(); }
+
+	// in the order of adding (stable output, i.e. for the serialization), O(N log N)
+	QVector<T*> orderedItems() const
+	{
+		QVector<QPair<quint64, T*>> serialItems;
+		serialItems.reserve(m_items.size());
+		for (int i = 0; i < m_items.size(); ++i)
+			serialItems.append(qMakePair(m_serials.at(i), m_items.at(i)));
+
+		std::sort(serialItems.begin(), serialItems.end(),
+			[](const QPair<quint64, T*>& p1, const QPair<quint64, T*>& p2) { return p1.first < p2.first; });
+
+		QVector<T*> result;
+		result.reserve(serialItems.size());
+		for (const auto& p : serialItems)
+			result.append(p.second);
+
+		return result;
+	}
+
+	bool contains(const void* handle) const { return m_index.contains(handle); }
+
+	bool add(const void* handle, T* item)
+	{
+		if (m_index.contains(handle))
+			return false;
+
+		m_index[handle] = m_items.size();
+		m_items.append(item);
+		m_handles.append(handle);
+		m_serials.append(m_nextSerial++);
+		return true;
+	}
+
+	bool remove(const void* handle)
+	{
+		auto it = m_index.find(handle);
+		if (it == m_index.end())
+			return false;
+
+		int index = *it;
+		m_index.erase(it);
+
+		int last = m_items.size() - 1;
+		if (index != last)
+		{
+			m_items[index] = m_items[last];
+			m_handles[index] = m_handles[last];
+			m_serials[index] = m_serials[last];
+			m_index[m_handles[index]] = index;
+		}
+
+		m_items.removeLast();
+		m_handles.removeLast();
+		m_serials.removeLast();
+		return true;
+	}
+
+	void clear()
+	{
+		m_items.clear();
+		m_handles.clear();
+		m_serials.clear();
+		m_index.clear();
+	}
+
+private:
+	QVector<T*> m_items;
+	QVector<const void*> m_handles;
+	QVector<quint64> m_serials;
+	quint64 m_nextSerial = 0;
+	QHash<const void*, int> m_index;
+};
@@ -0,0 +1,121 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include "CLayoutGraph.h"
+#include "CNodeEditorScene.h"
+#include "CNode.h"
+#include "CEdge.h"
+
+#include <QHash>
+
+
+void CLayoutGraph::fromScene(const CNodeEditorScene &scene)
+{
+	const auto &sceneNodes = scene.getNodes();
+	int count = sceneNodes.size();
+
+	nodes = sceneNodes.items();
+	x.resize(count);
+	y.resize(count);
+
+	QHash<const CNode*, int> nodeIndex;
+	nodeIndex.reserve(count);
+
+	for (int i = 0; i < count; ++i)
+	{
+		CNode *node = nodes.at(i);
+		x[i] = node->pos().x();
+		y[i] = node->pos().y();
+		nodeIndex[node] = i;
+	}
+
+	const auto &sceneEdges = scene.getEdges();
+
+	QVector<int> edgeSources, edgeTargets;
+	edgeSources.reserve(sceneEdges.size());
+	edgeTargets.reserve(sceneEdges.size());
+
+	for (CEdge *edge : sceneEdges)
+	{
+		int i1 = nodeIndex.value(edge->firstNode(), -1);
+		int i2 = nodeIndex.value(edge->lastNode(), -1);
+		if (i1 < 0 || i2 < 0 || i1 == i2)
+			continue;
+
+		edgeSources << i1;
+		edgeTargets << i2;
+	}
+
+	setEdges(count, edgeSources, edgeTargets);
+}
+
+
+void CLayoutGraph::toScene(CNodeEditorScene &scene) const
+{
+	Q_ASSERT(nodes.size() == x.size());
+
+	// the edges are recomputed once after all the moves
+	for (int i = 0; i < nodes.size(); ++i)
+	{
+		QPointF pos(x[i], y[i]);
+		if (nodes[i]->pos() != pos)
+			nodes[i]->setPos(pos);
+	}
+
+	scene.addUndoState();
+}
+
+
+QRectF CLayoutGraph::boundingRect() const
+{
+	if (x.isEmpty())
+		return QRectF();
+
+	double minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+
+	for (int i = 1; i < x.size(); ++i)
+	{
+		minX = qMin(minX, x[i]);
+		maxX = qMax(maxX, x[i]);
+		minY = qMin(minY, y[i]);
+		maxY = qMax(maxY, y[i]);
+	}
+
+	return QRectF(QPointF(minX, minY), QPointF(maxX, maxY));
+}
+
+
+void CLayoutGraph::setEdges(int count, const QVector<int> &sources, const QVector<int> &edgeTargets)
+{
+	Q_ASSERT(sources.size() == edgeTargets.size());
+
+	// count the degrees
+	offsets.fill(0, count + 1);
+
+	for (int e = 0; e < sources.size(); ++e)
+	{
+		offsets[sources[e] + 1]++;
+		offsets[edgeTargets[e] + 1]++;
+	}
+
+	for (int i = 0; i < count; ++i)
+		offsets[i + 1] += offsets[i];
+
+	// fill both directions
+	targets.resize(offsets[count]);
+
+	QVector<int> fill(offsets);
+
+	for (int e = 0; e < sources.size(); ++e)
+	{
+		int s = sources[e], t = edgeTargets[e];
+		targets[fill[s]++] = t;
+		targets[fill[t]++] = s;
+	}
+}
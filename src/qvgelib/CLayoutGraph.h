@@ -0,0 +1,48 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QVector>
+#include <QRectF>
+
+class CNode;
+class CNodeEditorScene;
+
+
+// Compact snapshot of the scene topology for the layout engines.
+// Positions are kept as plain coordinate arrays, the adjacency is stored as CSR:
+// the neighbours of the node i are targets[offsets[i] .. offsets[i+1]).
+// Every edge is stored in both directions, self-loops are dropped.
+
+class CLayoutGraph
+{
+public:
+	// scene -> snapshot
+	void fromScene(const CNodeEditorScene &scene);
+	// snapshot -> scene: all the positions at once, then a single undo state
+	void toScene(CNodeEditorScene &scene) const;
+
+	int nodeCount() const		{ return x.size(); }
+	int degree(int i) const		{ return offsets[i + 1] - offsets[i]; }
+
+	QRectF boundingRect() const;
+
+	// builds the CSR from the edge list (pairs of node indices)
+	void setEdges(int count, const QVector<int> &sources, const QVector<int> &edgeTargets);
+
+	// positions
+	QVector<double> x, y;
+
+	// adjacency
+	QVector<int> offsets, targets;
+
+	// scene nodes (empty for the derived graphs)
+	QVector<CNode*> nodes;
+};
@@ -0,0 +1,278 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include "CMultilevelLayout.h"
+#include "CForceDirectedLayout.h"
+#include "CLayoutGraph.h"
+#include "CNodeEditorScene.h"
+
+#include <qmath.h>
+
+
+static const double GOLDEN_ANGLE = 2.399963229728653;
+
+
+void CMultilevelLayout::doLayout(CNodeEditorScene &scene) const
+{
+	CLayoutGraph graph;
+	graph.fromScene(scene);
+
+	if (graph.nodeCount() == 0)
+		return;
+
+	run(graph);
+
+	graph.toScene(scene);
+}
+
+
+void CMultilevelLayout::run(CLayoutGraph &graph) const
+{
+	if (graph.nodeCount() == 0)
+		return;
+
+	double k = m_options.edgeLength;
+
+	CForceDirectedLayout engine;
+	CForceDirectedLayout::Options engineOptions;
+	engineOptions.edgeLength = k;
+	engineOptions.threaded = m_options.threaded;
+	engine.setOptions(engineOptions);
+
+	// level 0 is the graph itself; the weights (merged node counts) only steer the matching
+	QVector<CLayoutGraph> coarseGraphs;
+	QVector<QVector<double>> coarseWeights;
+	QVector<QVector<int>> coarseMaps;
+
+	auto level = [&](int l) -> CLayoutGraph& { return l == 0 ? graph : coarseGraphs[l - 1]; };
+
+	// coarsening
+	while (level(coarseGraphs.size()).nodeCount() > m_options.coarsestSize)
+	{
+		int l = coarseGraphs.size();
+
+		CLayoutGraph coarse;
+		QVector<double> coarseW;
+		QVector<int> coarseOf;
+		coarsen(level(l), l == 0 ? QVector<double>() : coarseWeights[l - 1], coarseOf, coarse, coarseW);
+
+		// nothing to merge anymore
+		if (coarse.nodeCount() > level(l).nodeCount() * 0.9)
+			break;
+
+		coarseGraphs << coarse;
+		coarseWeights << coarseW;
+		coarseMaps << coarseOf;
+	}
+
+	// few passes on the big levels: they start almost done
+	auto iterationsFor = [&](int count) {
+		return qBound(m_options.minIterations, int(m_options.iterations * 1000.0 / count), m_options.iterations);
+	};
+
+	// coarsest level from scratch
+	int top = coarseGraphs.size();
+	CLayoutGraph &coarsest = level(top);
+
+	CForceDirectedLayout::initialPlacement(coarsest, k);
+	refine(engine, coarsest, iterationsFor(coarsest.nodeCount()), k * (1 + qSqrt(coarsest.nodeCount()) * 0.05));
+
+	// back to the finest one
+	for (int l = top; l > 0; --l)
+	{
+		CLayoutGraph &coarse = level(l);
+		CLayoutGraph &fine = level(l - 1);
+
+		// room for the merged nodes
+		double ratio = double(fine.nodeCount()) / coarse.nodeCount();
+		CForceDirectedLayout::scaleToEdgeLength(coarse, k * qSqrt(ratio));
+
+		prolong(coarse, coarseMaps[l - 1], fine);
+
+		refine(engine, fine, iterationsFor(fine.nodeCount()), k);
+
+		// not needed anymore
+		coarseGraphs[l - 1] = CLayoutGraph();
+		coarseWeights[l - 1].clear();
+	}
+}
+
+
+void CMultilevelLayout::coarsen(const CLayoutGraph &fine, const QVector<double> &fineWeights,
+	QVector<int> &coarseOf, CLayoutGraph &coarse, QVector<double> &coarseWeights)
+{
+	int count = fine.nodeCount();
+
+	auto weightOf = [&](int i) { return fineWeights.isEmpty() ? 1.0 : fineWeights[i]; };
+
+	coarseOf.fill(-1, count);
+	coarseWeights.clear();
+
+	// low degrees first: the leaves are merged before the hubs are taken
+	int maxDegree = 0;
+	for (int i = 0; i < count; ++i)
+		maxDegree = qMax(maxDegree, fine.degree(i));
+
+	QVector<int> degreeStart(maxDegree + 2, 0);
+	for (int i = 0; i < count; ++i)
+		degreeStart[fine.degree(i) + 1]++;
+	for (int d = 0; d <= maxDegree; ++d)
+		degreeStart[d + 1] += degreeStart[d];
+
+	QVector<int> order(count);
+	for (int i = 0; i < count; ++i)
+		order[degreeStart[fine.degree(i)]++] = i;
+
+	// matching: every node with its lightest free neighbour
+	int pendingIsolated = -1;
+
+	for (int i : order)
+	{
+		if (coarseOf[i] >= 0)
+			continue;
+
+		// isolated nodes are merged with each other
+		if (fine.degree(i) == 0)
+		{
+			if (pendingIsolated < 0)
+			{
+				pendingIsolated = i;
+				continue;
+			}
+
+			coarseOf[i] = coarseOf[pendingIsolated] = coarseWeights.size();
+			coarseWeights << weightOf(i) + weightOf(pendingIsolated);
+			pendingIsolated = -1;
+			continue;
+		}
+
+		int best = -1;
+		for (int e = fine.offsets[i]; e < fine.offsets[i + 1]; ++e)
+		{
+			int j = fine.targets[e];
+			if (coarseOf[j] < 0 && j != pendingIsolated && (best < 0 || weightOf(j) < weightOf(best)))
+				best = j;
+		}
+
+		if (best >= 0)
+		{
+			coarseOf[i] = coarseOf[best] = coarseWeights.size();
+			coarseWeights << weightOf(i) + weightOf(best);
+		}
+	}
+
+	if (pendingIsolated >= 0)
+	{
+		coarseOf[pendingIsolated] = coarseWeights.size();
+		coarseWeights << weightOf(pendingIsolated);
+	}
+
+	// collapse: the rest joins the lightest neighbour group (stars shrink at once)
+	for (int i : order)
+	{
+		if (coarseOf[i] >= 0)
+			continue;
+
+		int best = -1;
+		for (int e = fine.offsets[i]; e < fine.offsets[i + 1]; ++e)
+		{
+			int c = coarseOf[fine.targets[e]];
+			if (c >= 0 && (best < 0 || coarseWeights[c] < coarseWeights[best]))
+				best = c;
+		}
+
+		if (best >= 0)
+		{
+			coarseOf[i] = best;
+			coarseWeights[best] += weightOf(i);
+		}
+		else
+		{
+			coarseOf[i] = coarseWeights.size();
+			coarseWeights << weightOf(i);
+		}
+	}
+
+	int coarseCount = coarseWeights.size();
+
+	// members of the coarse nodes (CSR)
+	QVector<int> memberOffsets(coarseCount + 1, 0);
+	for (int i = 0; i < count; ++i)
+		memberOffsets[coarseOf[i] + 1]++;
+	for (int c = 0; c < coarseCount; ++c)
+		memberOffsets[c + 1] += memberOffsets[c];
+
+	QVector<int> members(count);
+	QVector<int> fill(memberOffsets);
+	for (int i = 0; i < count; ++i)
+		members[fill[coarseOf[i]]++] = i;
+
+	// coarse edges: once per pair
+	QVector<int> sources, targets;
+	sources.reserve(fine.targets.size() / 2);
+	targets.reserve(fine.targets.size() / 2);
+
+	QVector<int> lastSeen(coarseCount, -1);
+
+	for (int c = 0; c < coarseCount; ++c)
+	{
+		for (int m = memberOffsets[c]; m < memberOffsets[c + 1]; ++m)
+		{
+			int i = members[m];
+			for (int e = fine.offsets[i]; e < fine.offsets[i + 1]; ++e)
+			{
+				int cj = coarseOf[fine.targets[e]];
+				if (cj > c && lastSeen[cj] != c)
+				{
+					lastSeen[cj] = c;
+					sources << c;
+					targets << cj;
+				}
+			}
+		}
+	}
+
+	coarse = CLayoutGraph();
+	coarse.x.fill(0.0, coarseCount);
+	coarse.y.fill(0.0, coarseCount);
+	coarse.setEdges(coarseCount, sources, targets);
+}
+
+
+void CMultilevelLayout::prolong(const CLayoutGraph &coarse, const QVector<int> &coarseOf, CLayoutGraph &fine) const
+{
+	// a small spiral around the coarse node, the refinement spreads them
+	double r = m_options.edgeLength * 0.1;
+
+	for (int i = 0; i < fine.nodeCount(); ++i)
+	{
+		int c = coarseOf[i];
+		double a = i * GOLDEN_ANGLE;
+		fine.x[i] = coarse.x[c] + r * qCos(a);
+		fine.y[i] = coarse.y[c] + r * qSin(a);
+	}
+}
+
+
+void CMultilevelLayout::refine(const CForceDirectedLayout &engine, CLayoutGraph &graph, int iterations, double startTemperature) const
+{
+	double k = m_options.edgeLength;
+	double minTemperature = k * 0.01;
+
+	for (int iter = 0; iter < iterations; ++iter)
+	{
+		double t = qMax(minTemperature, startTemperature * (1.0 - double(iter) / iterations));
+
+		double maxDisplacement = engine.step(graph, t);
+		if (maxDisplacement < k * 0.001)
+			break;
+	}
+
+	CForceDirectedLayout::scaleToEdgeLength(graph, k);
+}
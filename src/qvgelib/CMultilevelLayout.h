@@ -0,0 +1,60 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QVector>
+
+class CLayoutGraph;
+class CNodeEditorScene;
+class CForceDirectedLayout;
+
+
+// Multilevel layout for the big graphs.
+// The graph is coarsened by matching the neighbours until a few nodes are left,
+// the coarsest level is laid out from scratch, then every finer level starts
+// from the positions of its coarse nodes and is only refined by a few force passes.
+
+class CMultilevelLayout
+{
+public:
+	struct Options
+	{
+		// desired edge length
+		double edgeLength = 100;
+		// stop coarsening here
+		int coarsestSize = 50;
+		// force passes of the coarsest level, the finer levels get less
+		int iterations = 300;
+		int minIterations = 30;
+		bool threaded = true;
+	};
+
+	void setOptions(const Options &options)		{ m_options = options; }
+	const Options& getOptions() const			{ return m_options; }
+
+	// lays out the snapshot in place
+	void run(CLayoutGraph &graph) const;
+
+	// lays out the nodes of the scene: snapshot, run, write back as one undo step
+	void doLayout(CNodeEditorScene &scene) const;
+
+private:
+	// builds the next level; coarseOf maps the fine nodes to the coarse ones
+	static void coarsen(const CLayoutGraph &fine, const QVector<double> &fineWeights,
+		QVector<int> &coarseOf, CLayoutGraph &coarse, QVector<double> &coarseWeights);
+
+	// fine nodes start around their coarse nodes
+	void prolong(const CLayoutGraph &coarse, const QVector<int> &coarseOf, CLayoutGraph &fine) const;
+
+	// force passes with cooling, then back to the desired edge length
+	void refine(const CForceDirectedLayout &engine, CLayoutGraph &graph, int iterations, double startTemperature) const;
+
+	Options m_options;
+};
@@ -39,7 +39,7 @@ CNode::CNode(QGraphicsItem* parent) : QGraphicsRectItem(parent)
 	setCacheMode(DeviceCoordinateCache);
 
 	// label
-	m_labelItem = new QGraphicsSimpleTextItem(this);
+	m_labelItem = new CItemLabel(this);
 	m_labelItem->setFlags(0);
 	m_labelItem->setCacheMode(DeviceCoordinateCache);
 	m_labelItem->setPen(Qt::NoPen);
@@ -244,6 +244,9 @@ bool CNode::setAttribute(const QByteArray& attrId, const QVariant& v)
 
 	if (attrId == "z")
 	{
+		if (auto tracker = getChangeTracker())
+			tracker->onItemAttributeChanged(this, attrId, zValue(), v.toDouble());
+
 		setZValue(v.toDouble());
 		return true;
 	}
@@ -323,6 +326,8 @@ CNodePort* CNode::addPort(const QByteArray& portId, int align, double xoff, doub
 	CNodePort* port = new CNodePort(this, newPortId, align, xoff, yoff);
 	m_ports[newPortId] = port;
 
+	notifyPortsChanged();
+
 	updateCachedItems();
 
 	return port;
@@ -355,6 +360,8 @@ bool CNode::movePort(const QByteArray& portId, int align, double xoff, double yo
 	port->setAlign(align);
 	port->setOffset(xoff, yoff);
 
+	notifyPortsChanged();
+
 	updatePortsLayout();
 
 	return true;
@@ -396,6 +403,72 @@ CNodePort* CNode::getPort(const QByteArray& portId) const
 }
 
 
+QByteArray CNode::storePorts() const
+{
+	QByteArray data;
+	QDataStream out(&data, QIODevice::WriteOnly);
+
+	out << m_ports.size();
+
+	for (auto port : m_ports)
+		port->storeTo(out, CEditorScene::storageVersion());
+
+	return data;
+}
+
+
+void CNode::restorePorts(const QByteArray& data)
+{
+	QDataStream in(data);
+
+	int count = 0;
+	in >> count;
+
+	QSet<QByteArray> restoredIds;
+
+	QByteArray id;
+	int align;
+	double xoff, yoff;
+	QBrush br;
+	QPen pn;
+	QRectF r;
+
+	for (int i = 0; i < count; ++i)
+	{
+		in >> id;
+		in >> align >> xoff >> yoff;
+		in >> br >> pn >> r;
+
+		restoredIds << id;
+
+		CNodePort *port = m_ports.value(id);
+		if (!port)
+		{
+			port = new CNodePort(this, id, align, xoff, yoff);
+			m_ports[id] = port;
+		}
+		else
+		{
+			port->setAlign(align);
+			port->setOffset(xoff, yoff);
+		}
+
+		port->setBrush(br);
+		port->setPen(pn);
+		port->setRect(r);
+	}
+
+	// remove the ports which did not exist
+	for (const QByteArray& portId : m_ports.keys())
+	{
+		if (!restoredIds.contains(portId))
+			removePort(portId);
+	}
+
+	updatePortsLayout();
+}
+
+
 QByteArrayList CNode::getPortIds() const
 {
 	return m_ports.keys();
@@ -733,6 +806,8 @@ void CNode::onPortDeleted(CNodePort *port)
 	}
 
 	m_ports.remove(port->getId());
+
+	notifyPortsChanged();
 }
 
 
@@ -742,11 +817,21 @@ void CNode::onPortRenamed(CNodePort *port, const QByteArray& oldId)
 	{
 		edge->onNodePortRenamed(this, port->getId(), oldId);
 	}
+
+	notifyPortsChanged();
+}
+
+
+void CNode::onPortChanged(CNodePort* /*port*/)
+{
+	notifyPortsChanged();
 }
 
 
 void CNode::onItemMoved(const QPointF& /*delta*/)
 {
+	invalidateLabelLayout();
+
 	for (CEdge *conn : m_connections)
 	{
 		conn->onNodeMoved(this); 
@@ -820,8 +905,21 @@ QVariant CNode::itemChange(QGraphicsItem::GraphicsItemChange change, const QVari
 		// set default ID
 		setDefaultId();
 
+		// notify the scene
+		updateSceneAttachment();
+
 		// update attributes cache after attach to scene
-		updateCachedItems();
+		// (when restoring, onItemRestored() does it afterwards)
+		if (!s_duringRestore)
+			updateCachedItems();
+
+		return value;
+	}
+
+	if (change == ItemPositionChange)
+	{
+		if (auto tracker = getChangeTracker())
+			tracker->onItemMoved(this, pos(), value.toPointF());
 
 		return value;
 	}
@@ -849,24 +947,28 @@ QVariant CNode::itemChange(QGraphicsItem::GraphicsItemChange change, const QVari
 
 void CNode::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*)
 {
-	bool isSelected = (option->state & QStyle::State_Selected);
+	bool isSelected = isSelectionPainted(option);
 
-	painter->setClipRect(boundingRect());
+	const CItemStyle& style = getStyle();
 
+	// zoomed out: just a filled rect (a point at the end)
+	if (option->levelOfDetailFromTransform(painter->worldTransform()) < LOD_Simplified)
+	{
+		painter->setRenderHint(QPainter::Antialiasing, false);
 
-	// get color (to optimize!)
-	QColor color = getAttribute(QByteArrayLiteral("color")).value<QColor>();
-	if (color.isValid())
-		painter->setBrush(color);
-	else
-		painter->setBrush(Qt::NoBrush);
+		if (isSelected)
+			painter->fillRect(Shape::boundingRect(), Qt::darkCyan);
+		else
+			painter->fillRect(Shape::boundingRect(), style.brush.style() == Qt::NoBrush ? QBrush(style.pen.color()) : style.brush);
 
-	qreal strokeSize = getAttribute(QByteArrayLiteral("stroke.size")).toDouble();
-	strokeSize = qMax(0.1, strokeSize);
+		return;
+	}
 
-	QColor strokeColor = getAttribute(QByteArrayLiteral("stroke.color")).value<QColor>();
+	painter->setClipRect(boundingRect());
 
-	int strokeStyle = CUtils::textToPenStyle(getAttribute(QByteArrayLiteral("stroke.style")).toString(), Qt::SolidLine);
+	painter->setBrush(style.brush);
+
+	qreal strokeSize = style.pen.widthF();
 
 	// selection background outline
 	if (isSelected)
@@ -892,7 +994,7 @@ void CNode::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWi
 	else
 		painter->setOpacity(1.0);
 
-	painter->setPen(QPen(strokeColor, strokeSize, (Qt::PenStyle)strokeStyle));
+	painter->setPen(style.pen);
 
 	// draw shape: disc if no cache
 	if (m_shapeCache.isEmpty())
@@ -942,6 +1044,34 @@ void CNode::updateCachedItems()
 }
 
 
+void CNode::notifyPortsChanged()
+{
+	if (auto tracker = getChangeTracker())
+		tracker->onNodePortsChanged(this);
+}
+
+
+void CNode::updateStyle()
+{
+	Super::updateStyle();
+
+	QColor color = getAttribute(QByteArrayLiteral("color")).value<QColor>();
+	if (color.isValid())
+		m_style.brush = QBrush(color);
+	else
+		m_style.brush = QBrush(Qt::NoBrush);
+
+	qreal strokeSize = getAttribute(QByteArrayLiteral("stroke.size")).toDouble();
+	strokeSize = qMax(0.1, strokeSize);
+
+	QColor strokeColor = getAttribute(QByteArrayLiteral("stroke.color")).value<QColor>();
+
+	int strokeStyle = CUtils::textToPenStyle(getAttribute(QByteArrayLiteral("stroke.style")).toString(), Qt::SolidLine);
+
+	m_style.pen = QPen(strokeColor, strokeSize, (Qt::PenStyle)strokeStyle);
+}
+
+
 void CNode::updatePortsLayout()
 {
 	prepareGeometryChange();
@@ -74,6 +74,10 @@ public:
 	CNodePort* getPort(const QByteArray& portId) const;
 	QByteArrayList getPortIds() const;
 
+	// ports state as a whole (used by undo)
+	QByteArray storePorts() const;
+	void restorePorts(const QByteArray& data);
+
 	// serialization 
 	virtual bool storeTo(QDataStream& out, quint64 version64) const;
 	virtual bool restoreFrom(QDataStream& out, quint64 version64);
@@ -114,6 +118,7 @@ public:
 
 	virtual void onPortDeleted(CNodePort *port);
 	virtual void onPortRenamed(CNodePort *port, const QByteArray& oldId);
+	virtual void onPortChanged(CNodePort *port);
 
 	virtual void onItemMoved(const QPointF& delta) override;
 	virtual void onItemRestored() override;
@@ -133,10 +138,12 @@ protected:
 	virtual void updatePortsLayout();
 	virtual void updateLabelPosition();
 	virtual void updateCachedItems();
+	virtual void updateStyle();
 
 private:
 	void recalculateShape();
 	void updateConnections();
+	void notifyPortsChanged();
 
 	void resize(float size)			{ setRect(-size / 2, -size / 2, size, size); }
 	void resize(float w, float h)	{ setRect(-w / 2, -h / 2, w, h); }
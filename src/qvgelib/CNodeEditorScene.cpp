@@ -18,6 +18,10 @@
 #include <QApplication>
 #include <QDebug>
 #include <QElapsedTimer>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
 
 
 CNodeEditorScene::CNodeEditorScene(QObject *parent) : 
@@ -42,6 +46,80 @@ CNodeEditorScene::CNodeEditorScene(QObject *parent) :
 }
 
 
+CNodeEditorScene::~CNodeEditorScene()
+{
+	// the ports are destroyed by the base scene: detach them from the dying registry
+	for (auto port : m_ports)
+		port->m_attachedScene = nullptr;
+}
+
+
+// graph import: parsed in the worker threads, no items touched there
+
+struct NodeData
+{
+	const Node* source = nullptr;
+	QVector<QPair<QByteArray, QVariant>> attrs;		// converted to the types CNode expects
+};
+
+
+struct EdgeData
+{
+	const Edge* source = nullptr;
+	QVector<QPair<QByteArray, QVariant>> attrs;
+	bool isPolyEdge = false;
+	QList<QPointF> points;
+};
+
+
+static QVariant parseNodeAttribute(const QByteArray& attrId, const QVariant& v)
+{
+	if (attrId == "x" || attrId == "y" || attrId == "z" || attrId == "width" || attrId == "height")
+		return v.toDouble();
+
+	if (attrId == "pos")
+		return v.toPointF();
+
+	if (attrId == "size" && v.type() != QVariant::Size && v.type() != QVariant::SizeF)
+	{
+		// not positive: left as is, CNode rejects it
+		float s = v.toFloat();
+		if (s > 0)
+			return QSizeF(s, s);
+	}
+
+	return v;
+}
+
+
+static void parseNodeData(NodeData& data)
+{
+	const auto& attrs = data.source->attrs;
+	data.attrs.reserve(attrs.size());
+
+	for (auto it = attrs.constBegin(); it != attrs.constEnd(); ++it)
+		data.attrs << qMakePair(it.key(), parseNodeAttribute(it.key(), it.value()));
+}
+
+
+static void parseEdgeData(EdgeData& data)
+{
+	const auto& attrs = data.source->attrs;
+	data.attrs.reserve(attrs.size());
+
+	for (auto it = attrs.constBegin(); it != attrs.constEnd(); ++it)
+	{
+		if (it.key() == "points")
+		{
+			data.isPolyEdge = true;
+			data.points = CUtils::pointsFromString(it.value().toString());
+		}
+
+		data.attrs << qMakePair(it.key(), it.value());
+	}
+}
+
+
 bool CNodeEditorScene::fromGraph(const Graph& g)
 {
 	reset();
@@ -79,7 +157,7 @@ bool CNodeEditorScene::fromGraph(const Graph& g)
 			continue;
 		}
 
-		if (attr.id == attr_size)
+		if (attr.id == attr_size && attr.defaultValue.type() != QVariant::SizeF)
 			continue;	// ignore for now
 
 		createClassAttribute("node", attr.id, attr.name, attr.defaultValue, ATTR_NONE);
@@ -99,56 +177,109 @@ bool CNodeEditorScene::fromGraph(const Graph& g)
 	}
 
 
+	// Bulk load: the attribute values are parsed in parallel into plain structs,
+	// the items are set up from them in the GUI thread, attached at once in the restore mode
+	// and their geometry is calculated by the scheduled (threaded) edge geometry update.
 	// Nodes
-	QMap<QByteArray, CNode*> nodesMap;
+	QVector<NodeData> nodesData(g.nodes.size());
+	for (int i = 0; i < g.nodes.size(); ++i)
+		nodesData[i].source = &g.nodes.at(i);
+
+	QtConcurrent::blockingMap(nodesData, parseNodeData);
+
+	QVector<CNode*> nodes;
+	nodes.reserve(nodesData.size());
 
-	for (const Node& n : g.nodes)
+	QHash<QByteArray, CNode*> nodesMap;
+	nodesMap.reserve(nodesData.size());
+
+	for (const NodeData& data : nodesData)
 	{
 		CNode* node = createNewNode();
-		addItem(node);
+		node->setId(data.source->id);
 
-		node->setId(n.id);
-		nodesMap[n.id] = node;
+		for (const auto& attr : data.attrs)
+			node->setAttribute(attr.first, attr.second);
 
-		for (auto it = n.attrs.constBegin(); it != n.attrs.constEnd(); ++it)
-		{
-			node->setAttribute(it.key(), it.value());
-		}
-
-		for (auto it = n.ports.constBegin(); it != n.ports.constEnd(); ++it)
+		const auto& ports = data.source->ports;
+		for (auto it = ports.constBegin(); it != ports.constEnd(); ++it)
 		{
 			CNodePort* port = node->addPort(it.key().toLatin1(), it.value().anchor, it.value().x, it.value().y);
 			Q_ASSERT(port != nullptr);
 			port->setColor(it.value().color);
 		}
+
+		nodes << node;
+		nodesMap[data.source->id] = node;
 	}
 
 
 	// Edges
-	for (const Edge& e : g.edges)
+	QVector<EdgeData> edgesData(g.edges.size());
+	for (int i = 0; i < g.edges.size(); ++i)
+		edgesData[i].source = &g.edges.at(i);
+
+	QtConcurrent::blockingMap(edgesData, parseEdgeData);
+
+	QVector<CEdge*> edges;
+	edges.reserve(edgesData.size());
+
+	for (const EdgeData& data : edgesData)
 	{
-		bool isPolyEdge = e.attrs.contains("points");
-		CPolyEdge* polyEdge = isPolyEdge ? new CPolyEdge : nullptr;
-		if (polyEdge)
+		CEdge* edge = nullptr;
+		if (data.isPolyEdge)
 		{
-			QString pointStr = e.attrs["points"].toString();
-			polyEdge->setPoints(CUtils::pointsFromString(pointStr));
+			CPolyEdge* polyEdge = new CPolyEdge;
+			polyEdge->setPoints(data.points);
+			edge = polyEdge;
 		}
+		else
+			edge = new CDirectEdge;
 
-		CEdge* edge = polyEdge ? polyEdge : new CDirectEdge;
-		addItem(edge);
+		edge->setId(data.source->id);
 
-		edge->setId(e.id);
-		edge->setFirstNode(nodesMap[e.startNodeId], e.startPortId);
-		edge->setLastNode(nodesMap[e.endNodeId], e.endPortId);
+		for (const auto& attr : data.attrs)
+			edge->setAttribute(attr.first, attr.second);
 
-		for (auto it = e.attrs.constBegin(); it != e.attrs.constEnd(); ++it)
-		{
-			edge->setAttribute(it.key(), it.value());
-		}
+		edges << edge;
+	}
+
+
+	// attach to the scene
+	CItem::beginRestore();
+
+	for (auto node : nodes)
+		addItem(node);
+
+	for (int i = 0; i < edges.size(); ++i)
+	{
+		CEdge* edge = edges[i];
+		const Edge* e = edgesData[i].source;
+		edge->setFirstNode(nodesMap.value(e->startNodeId), e->startPortId);
+		edge->setLastNode(nodesMap.value(e->endNodeId), e->endPortId);
+		addItem(edge);
 	}
 
+	CItem::endRestore();
+
+	for (auto node : nodes)
+		node->onItemRestored();
+
+	// the edges update their caches only (the geometry is skipped while restoring)...
+	CItem::beginRestore();
+
+	for (auto edge : edges)
+		edge->onItemRestored();
+
+	CItem::endRestore();
+
+	// ...and get it from the scheduled update
+	for (auto edge : edges)
+		scheduleEdgeGeometry(edge);
+
 	// finalize
+	flushPendingGeometry();
+
 	setSceneRect(itemsBoundingRect());
 
 	addUndoState();
@@ -221,8 +352,9 @@ bool CNodeEditorScene::toGraph(Graph& g)
 
 
 	// nodes
-	auto nodes = getItems<CNode>();
-	for (const auto &node : nodes)
+	// in the order of creation: same content, same output
+	g.nodes.reserve(m_nodes.size());
+	for (const auto &node : m_nodes.orderedItems())
 	{
 		Node n;
 		n.id = node->getId().toLatin1();
@@ -257,8 +389,8 @@ bool CNodeEditorScene::toGraph(Graph& g)
 
 
 	// edges
-	auto edges = getItems<CEdge>();
-	for (const auto &edge : edges)
+	g.edges.reserve(m_edges.size());
+	for (const auto &edge : m_edges.orderedItems())
 	{
 		Edge e;
 		e.id = edge->getId().toLatin1();
@@ -1080,7 +1212,265 @@ bool CNodeEditorScene::doUpdateCursorState(Qt::KeyboardModifiers keys, Qt::Mouse
 
 void CNodeEditorScene::drawBackground(QPainter *painter, const QRectF &r)
 {
+	// moved edges before anything is painted
+	updateEdgeGeometry();
+
     Super::drawBackground(painter, r);
+
+	// edges are below the nodes: draw them here when zoomed out
+	if (m_edgesBatching && QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform()) < LOD_Simplified)
+	{
+		updateEdgeBatches();
+		drawEdgeBatches(painter, r);
+	}
+}
+
+
+// scheduled edge geometry
+
+// below this the thread pool costs more than it saves
+static const int EDGE_GEOMETRY_THREADED_MIN = 500;
+
+
+void CNodeEditorScene::scheduleEdgeGeometry(CEdge *edge)
+{
+	Q_ASSERT(edge);
+
+	m_dirtyEdgeGeometry[edge] = edge;
+
+	if (!m_edgeGeometryPosted)
+	{
+		m_edgeGeometryPosted = true;
+		QTimer::singleShot(0, this, &CNodeEditorScene::updateEdgeGeometry);
+	}
+}
+
+
+void CNodeEditorScene::updateEdgeGeometry()
+{
+	m_edgeGeometryPosted = false;
+
+	if (m_dirtyEdgeGeometry.isEmpty())
+		return;
+
+	QList<CEdge*> edges = m_dirtyEdgeGeometry.values();
+	m_dirtyEdgeGeometry.clear();
+
+	if (m_edgeGeometryThreaded && edges.size() >= EDGE_GEOMETRY_THREADED_MIN)
+	{
+		QVector<CEdge*> jobs;
+		jobs.reserve(edges.size());
+
+		for (auto edge : edges)
+		{
+			if (edge->canPrepareGeometry())
+				jobs << edge;
+		}
+
+		QtConcurrent::blockingMap(jobs, [](CEdge *edge)
+		{
+			edge->prepareGeometry();
+		});
+	}
+
+	// scene changes are serial
+	for (auto edge : edges)
+		edge->updateGeometry();
+}
+
+
+// batched edges
+
+static QRectF lineBounds(const QLineF &l)
+{
+	return QRectF(l.p1(), l.p2()).normalized();
+}
+
+
+// zoomed out edges are hairlines (as CEdge::drawSimplified() draws them): the color only
+static QRgb edgePenKey(const QPen &pen)
+{
+	return pen.color().rgba();
+}
+
+
+void CNodeEditorScene::enableEdgesBatching(bool on)
+{
+	if (m_edgesBatching == on)
+		return;
+
+	m_edgesBatching = on;
+
+	// edges are painting themselves again
+	for (const auto& slot : m_edgeSlots)
+		slot.edge->setBatchedDrawing(false);
+
+	m_edgeBatches.clear();
+	m_edgeBatchIndex.clear();
+	m_edgeSlots.clear();
+	m_dirtyEdgeSlots.clear();
+	m_edgeBatchesDirty = true;
+
+	update();
+}
+
+
+void CNodeEditorScene::updateEdgeBatches()
+{
+	if (!m_edgeBatchesDirty && !m_dirtyEdgeSlots.isEmpty())
+	{
+		QVector<QLineF> lines;
+
+		// moved edges are rewritten in place
+		for (auto handle : m_dirtyEdgeSlots)
+		{
+			auto it = m_edgeSlots.constFind(handle);
+			if (it == m_edgeSlots.constEnd())
+				continue;
+
+			const EdgeSlot& slot = *it;
+
+			// hidden or covered now: out of the batches
+			if (!slot.edge->hasVisibleGeometry())
+			{
+				m_edgeBatchesDirty = true;
+				break;
+			}
+
+			getEdgeBatchLines(slot.edge, lines);
+
+			int batch = m_edgeBatchIndex.value(edgePenKey(slot.edge->getStyle().pen), -1);
+
+			// other pen or number of segments: regroup everything
+			if (batch != slot.batch || lines.size() != slot.count)
+			{
+				m_edgeBatchesDirty = true;
+				break;
+			}
+
+			EdgeBatch &edgeBatch = m_edgeBatches[batch];
+			std::copy(lines.constBegin(), lines.constEnd(), edgeBatch.lines.begin() + slot.first);
+
+			for (const QLineF &l : lines)
+				edgeBatch.bounds |= lineBounds(l);
+		}
+
+		m_dirtyEdgeSlots.clear();
+	}
+
+	if (m_edgeBatchesDirty)
+		rebuildEdgeBatches();
+}
+
+
+void CNodeEditorScene::rebuildEdgeBatches()
+{
+	m_edgeBatches.clear();
+	m_edgeBatchIndex.clear();
+	m_edgeSlots.clear();
+	m_dirtyEdgeSlots.clear();
+	m_edgeBatchesDirty = false;
+
+	m_edgeSlots.reserve(m_edges.size());
+
+	QVector<QLineF> lines;
+
+	for (auto edge : m_edges)
+	{
+		// painted by nothing anyway
+		if (!edge->hasVisibleGeometry())
+		{
+			edge->setBatchedDrawing(false);
+			continue;
+		}
+
+		getEdgeBatchLines(edge, lines);
+
+		const QPen& pen = edge->getStyle().pen;
+		EdgePenKey key = edgePenKey(pen);
+
+		auto batchIt = m_edgeBatchIndex.constFind(key);
+		int batch = (batchIt == m_edgeBatchIndex.constEnd()) ? -1 : *batchIt;
+		if (batch < 0)
+		{
+			batch = m_edgeBatches.size();
+			m_edgeBatchIndex[key] = batch;
+
+			EdgeBatch edgeBatch;
+			edgeBatch.pen = QPen(pen.color(), 0);
+			m_edgeBatches.append(edgeBatch);
+		}
+
+		QVector<QLineF> &batchLines = m_edgeBatches[batch].lines;
+
+		EdgeSlot slot;
+		slot.edge = edge;
+		slot.batch = batch;
+		slot.first = batchLines.size();
+		slot.count = lines.size();
+		m_edgeSlots[static_cast<CItem*>(edge)] = slot;
+
+		batchLines += lines;
+
+		QRectF &bounds = m_edgeBatches[batch].bounds;
+		for (const QLineF &l : lines)
+			bounds |= lineBounds(l);
+
+		edge->setBatchedDrawing(true);
+	}
+}
+
+
+void CNodeEditorScene::drawEdgeBatches(QPainter *painter, const QRectF &exposedRect)
+{
+	painter->save();
+	painter->setRenderHint(QPainter::Antialiasing, false);
+	painter->setBrush(Qt::NoBrush);
+
+	// partial repaints: the lines outside are clipped before rasterizing
+	painter->setClipRect(exposedRect, Qt::IntersectClip);
+
+	// a pixel around: the straight (flat bounds) batches are kept too
+	qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+	qreal margin = lod > 0 ? 1.0 / lod : 1.0;
+
+	for (const auto& edgeBatch : m_edgeBatches)
+	{
+		if (edgeBatch.lines.isEmpty())
+			continue;
+
+		if (!edgeBatch.bounds.adjusted(-margin, -margin, margin, margin).intersects(exposedRect))
+			continue;
+
+		painter->setPen(edgeBatch.pen);
+		painter->drawLines(edgeBatch.lines);
+	}
+
+	painter->restore();
+}
+
+
+void CNodeEditorScene::getEdgeBatchLines(CEdge *edge, QVector<QLineF> &lines)
+{
+	lines.clear();
+
+	QLineF l = edge->line().translated(edge->pos());
+
+	// polyline: one line per segment
+	auto polyEdge = dynamic_cast<CPolyEdge*>(edge);
+	if (polyEdge && polyEdge->getPoints().size())
+	{
+		QPointF last = l.p1();
+		for (const QPointF &p : polyEdge->getPoints())
+		{
+			lines << QLineF(last, p);
+			last = p;
+		}
+
+		lines << QLineF(last, l.p2());
+	}
+	else
+		lines << l;
 }
 
 
@@ -1152,6 +1542,94 @@ void CNodeEditorScene::prefetchSelection() const
 }
 
 
+// callbacks
+
+void CNodeEditorScene::onItemAdded(CItem *citem)
+{
+	Super::onItemAdded(citem);
+
+	// classify once
+	if (CNode* node = dynamic_cast<CNode*>(citem))
+		m_nodes.add(citem, node);
+	else if (CEdge* edge = dynamic_cast<CEdge*>(citem))
+	{
+		m_edges.add(citem, edge);
+		m_edgeBatchesDirty = true;
+	}
+}
+
+
+void CNodeEditorScene::onItemRemoved(CItem *citem)
+{
+	Super::onItemRemoved(citem);
+
+	if (!m_nodes.remove(citem) && m_edges.remove(citem))
+	{
+		auto it = m_edgeSlots.find(citem);
+		if (it != m_edgeSlots.end())
+			it->edge->setBatchedDrawing(false);
+
+		m_edgeSlots.remove(citem);
+		m_dirtyEdgeSlots.remove(citem);
+		m_dirtyEdgeGeometry.remove(citem);
+		m_edgeBatchesDirty = true;
+	}
+}
+
+
+void CNodeEditorScene::onItemDestroyed(CItem *citem)
+{
+	Super::onItemDestroyed(citem);
+
+	// citem is not a CNode/CEdge anymore: remove by pointer only
+	if (!m_nodes.remove(citem) && m_edges.remove(citem))
+	{
+		m_edgeSlots.remove(citem);
+		m_dirtyEdgeSlots.remove(citem);
+		m_dirtyEdgeGeometry.remove(citem);
+		m_edgeBatchesDirty = true;
+	}
+}
+
+
+void CNodeEditorScene::onEdgeRelinked(CEdge *edge)
+{
+	Q_EMIT edgeRelinked(edge);
+}
+
+
+void CNodeEditorScene::onItemGeometryChanged(CItem *citem)
+{
+	if (m_edgeSlots.contains(citem))
+	{
+		m_dirtyEdgeSlots.insert(citem);
+		return;
+	}
+
+	// skipped before (hidden or covered) but has to be drawn now
+	if (m_edges.contains(citem))
+	{
+		CEdge *edge = dynamic_cast<CEdge*>(citem);
+		if (edge && edge->hasVisibleGeometry())
+			m_edgeBatchesDirty = true;
+	}
+}
+
+
+void CNodeEditorScene::onPortAdded(CNodePort *port)
+{
+	Q_ASSERT(port);
+
+	m_ports.add(port, port);
+}
+
+
+void CNodeEditorScene::onPortRemoved(CNodePort *port)
+{
+	m_ports.remove(port);
+}
+
+
 // menu & actions
 
 QObject* CNodeEditorScene::createActions()
@@ -36,6 +36,7 @@ public:
 	typedef CEditorScene Super;
 
 	CNodeEditorScene(QObject *parent = NULL);
+	virtual ~CNodeEditorScene();
 
 	// reimp
 	virtual CEditorScene* createScene() const {
@@ -75,15 +76,43 @@ public:
 
 	virtual int getBoundingMargin() const { return 5; }
 
+	// zoomed out: all the edges are drawn by the scene in one pass per pen
+	void enableEdgesBatching(bool on = true);
+	bool isEdgesBatchingEnabled() const { return m_edgesBatching; }
+
+	// moved nodes: the edges are recomputed once per frame (big batches in parallel)
+	void scheduleEdgeGeometry(CEdge *edge);
+	void setEdgeGeometryThreaded(bool on)	{ m_edgeGeometryThreaded = on; }
+	bool isEdgeGeometryThreaded() const		{ return m_edgeGeometryThreaded; }
+
     const QList<CNode*>& getSelectedNodes() const;
     const QList<CEdge*>& getSelectedEdges() const;
 	const QList<CItem*>& getSelectedNodesEdges() const;
 
+	// registered items (no copying & O(1) counts)
+	const CItemRegistry<CNode>& getNodes() const		{ return m_nodes; }
+	const CItemRegistry<CEdge>& getEdges() const		{ return m_edges; }
+	const CItemRegistry<CNodePort>& getPorts() const	{ return m_ports; }
+
+	// callbacks
+	virtual void onItemAdded(CItem *citem);
+	virtual void onItemRemoved(CItem *citem);
+	virtual void onItemDestroyed(CItem *citem);
+	virtual void onItemGeometryChanged(CItem *citem);
+	virtual void flushPendingGeometry()		{ updateEdgeGeometry(); }
+	void onEdgeRelinked(CEdge *edge);
+	void onPortAdded(CNodePort *port);
+	void onPortRemoved(CNodePort *port);
+
 Q_SIGNALS:
 	void editModeChanged(int mode);
+	// direct: the start or the end of an edge on the scene has been changed
+	void edgeRelinked(CEdge *edge);
 
 public Q_SLOTS:
 	void setEditMode(EditMode mode);
+	// recomputes the scheduled edges right now
+	void updateEdgeGeometry();
 
 protected Q_SLOTS:
 	virtual void onSelectionChanged();
@@ -117,6 +146,12 @@ protected:
     // draw
     virtual void drawBackground(QPainter *painter, const QRectF &);
 
+	// batched edges
+	void updateEdgeBatches();
+	void rebuildEdgeBatches();
+	void drawEdgeBatches(QPainter *painter, const QRectF &exposedRect);
+	static void getEdgeBatchLines(CEdge *edge, QVector<QLineF> &lines);
+
 protected:
 	// edit mode
 	EditMode m_editMode;
@@ -135,6 +170,11 @@ protected:
 	CNode *m_nodesFactory = nullptr;
 	CEdge *m_edgesFactory = nullptr;
 
+	// item registries
+	CItemRegistry<CNode> m_nodes;
+	CItemRegistry<CEdge> m_edges;
+	CItemRegistry<CNodePort> m_ports;
+
     // cached selections
     mutable QList<CNode*> m_selNodes;
 	mutable QList<CEdge*> m_selEdges;
@@ -142,6 +182,35 @@ protected:
 
     // drawing
     int m_nextIndex = 0;
+
+	// batched edges: lines grouped by pen
+	struct EdgeBatch
+	{
+		QPen pen;
+		QVector<QLineF> lines;
+		QRectF bounds;
+	};
+
+	struct EdgeSlot
+	{
+		CEdge *edge = nullptr;
+		int batch = -1, first = 0, count = 0;
+	};
+
+	// color of the cosmetic pen
+	typedef QRgb EdgePenKey;
+
+	bool m_edgesBatching = true;
+	bool m_edgeBatchesDirty = true;
+	QVector<EdgeBatch> m_edgeBatches;
+	QHash<EdgePenKey, int> m_edgeBatchIndex;
+	QHash<const void*, EdgeSlot> m_edgeSlots;
+	QSet<const void*> m_dirtyEdgeSlots;
+
+	// scheduled edge geometry
+	bool m_edgeGeometryThreaded = true;
+	bool m_edgeGeometryPosted = false;
+	QHash<const void*, CEdge*> m_dirtyEdgeGeometry;
 };
 
 
@@ -9,6 +9,7 @@ It can be used freely, maintaining the information above.
 
 #include "CNodePort.h"
 #include "CNode.h"
+#include "CNodeEditorScene.h"
 
 
 CNodePort::CNodePort(CNode *node, const QByteArray& portId, int align, double xoff, double yoff) :
@@ -25,16 +26,51 @@ CNodePort::CNodePort(CNode *node, const QByteArray& portId, int align, double xo
 	setToolTip(portId);
 
 	setFlags(QGraphicsItem::ItemClipsToShape | QGraphicsItem::ItemIgnoresParentOpacity);
+
+	// the node could be in a scene already
+	updateSceneAttachment();
 }
 
 
 CNodePort::~CNodePort()
 {
+	if (m_attachedScene)
+		m_attachedScene->onPortRemoved(this);
+
 	if (m_node)
 		m_node->onPortDeleted(this);
 }
 
 
+QVariant CNodePort::itemChange(QGraphicsItem::GraphicsItemChange change, const QVariant &value)
+{
+	if (change == ItemSceneHasChanged)
+	{
+		updateSceneAttachment();
+
+		return value;
+	}
+
+	return Shape::itemChange(change, value);
+}
+
+
+void CNodePort::updateSceneAttachment()
+{
+	auto nodeScene = dynamic_cast<CNodeEditorScene*>(scene());
+	if (nodeScene == m_attachedScene)
+		return;
+
+	if (m_attachedScene)
+		m_attachedScene->onPortRemoved(this);
+
+	m_attachedScene = nodeScene;
+
+	if (m_attachedScene)
+		m_attachedScene->onPortAdded(this);
+}
+
+
 void CNodePort::onParentDeleted()
 {
 	// clear m_node if it is removed already
@@ -101,6 +137,9 @@ QColor CNodePort::getColor() const
 void CNodePort::setColor(const QColor& color)
 {
 	setBrush(color);
+
+	if (m_node)
+		m_node->onPortChanged(this);
 }
 
 
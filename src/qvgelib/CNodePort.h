@@ -15,6 +15,7 @@ It can be used freely, maintaining the information above.
 
 
 class CNode;
+class CNodeEditorScene;
 
 
 class CNodePort : public QGraphicsRectItem, public IInteractive
@@ -56,7 +57,15 @@ public:
 	//virtual void hoverLeaveEvent(QGraphicsSceneHoverEvent *event);
 
 protected:
+	// reimp
+	virtual QVariant itemChange(QGraphicsItem::GraphicsItemChange change, const QVariant &value);
+
+	void updateSceneAttachment();
+
+	friend class CNodeEditorScene;
+
 	CNode *m_node = nullptr;
+	CNodeEditorScene *m_attachedScene = nullptr;
 
 	QByteArray m_id;
 	int m_align;
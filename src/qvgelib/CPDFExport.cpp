@@ -13,7 +13,6 @@ It can be used freely, maintaining the information above.
 #include <QPageLayout> 
 #include <QMarginsF> 
 #include <QDebug> 
-#include <QScopedPointer>
 
 #include "CPDFExport.h"
 #include "CEditorScene.h"
@@ -126,9 +125,8 @@ bool CPDFExport::save(const QString& fileName, CEditorScene& scene, QString* /*l
 {
 	Q_ASSERT(m_printer);
 
-	QScopedPointer<CEditorScene> tempScene(scene.clone());
-
-	tempScene->crop();
+	CEditorScene::RenderOptions options;
+	options.cropToContent = true;
 
 	QPdfWriter writer(fileName);
 	writer.setPageSize(m_printer->pageSize());
@@ -138,7 +136,7 @@ bool CPDFExport::save(const QString& fileName, CEditorScene& scene, QString* /*l
 	QPainter painter(&writer);
 	painter.setRenderHint(QPainter::Antialiasing);
 	painter.setRenderHint(QPainter::TextAntialiasing);
-	tempScene->render(&painter);
+	scene.renderScene(&painter, QRectF(), options);
 	painter.end();
 
 	return true;
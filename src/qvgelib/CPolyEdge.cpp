@@ -21,6 +21,8 @@ CPolyEdge::CPolyEdge(QGraphicsItem *parent): Super(parent)
 
 void CPolyEdge::setPoints(const QList<QPointF> &points)
 {
+	notifyPointsChanged(m_polyPoints, points);
+
 	m_polyPoints = points;
 
 	onParentGeometryChanged();
@@ -32,6 +34,8 @@ bool CPolyEdge::insertPointAt(const QPointF &pos)
 	// no points yet
 	if (m_polyPoints.isEmpty())
 	{
+		notifyPointsChanged(m_polyPoints, { pos });
+
 		m_polyPoints.append(pos);
 		update();
 		return true;
@@ -49,7 +53,10 @@ bool CPolyEdge::insertPointAt(const QPointF &pos)
 		qreal l3 = QLineF(pos, points.at(i + 1)).length();
 		if (qAbs(l1 - (l2 + l3)) < 1)
 		{
+			auto oldPoints = m_polyPoints;
 			m_polyPoints.insert(i, pos);
+			notifyPointsChanged(oldPoints, m_polyPoints);
+
 			update();
 			return true;
 		}
@@ -83,7 +90,10 @@ CEdge* CPolyEdge::clone()
 
 void CPolyEdge::reverse()
 {
+	auto oldPoints = m_polyPoints;
 	std::reverse(m_polyPoints.begin(), m_polyPoints.end());
+	notifyPointsChanged(oldPoints, m_polyPoints);
+
 	std::reverse(m_controlPoints.begin(), m_controlPoints.end());
 
 	Super::reverse();
@@ -96,6 +106,8 @@ void CPolyEdge::transform(const QRectF & oldRect, const QRectF & newRect,
 {
 	Super::transform(oldRect, newRect, xc, yc, changeSize, changePos);
 
+	auto oldPoints = m_polyPoints;
+
 	// snap
 	//auto scene = getScene();
 
@@ -118,6 +130,8 @@ void CPolyEdge::transform(const QRectF & oldRect, const QRectF & newRect,
 		}
 	}
 
+	notifyPointsChanged(oldPoints, m_polyPoints);
+
 	createControlPoints();
 	updateShapeFromPoints();
 }
@@ -251,11 +265,15 @@ void CPolyEdge::onItemSelected(bool state)
 
 void CPolyEdge::onItemMoved(const QPointF& delta)
 {
+	auto oldPoints = m_polyPoints;
+
 	for (auto &p : m_polyPoints)
 	{
 		p += delta;
 	}
 
+	notifyPointsChanged(oldPoints, m_polyPoints);
+
 	for (auto cp : m_controlPoints)
 	{
 		cp->moveBy(delta.x(), delta.y());
@@ -274,6 +292,22 @@ void CPolyEdge::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 		return;
 	}
 
+	// cached pen
+	checkStyle();
+
+	// zoomed out: no points & arrows
+	if (option->levelOfDetailFromTransform(painter->worldTransform()) < LOD_Simplified)
+	{
+		QPolygonF polyline;
+		polyline << line().p1();
+		for (const QPointF &p : m_polyPoints)
+			polyline << p;
+		polyline << line().p2();
+
+		drawSimplified(painter, option, polyline);
+		return;
+	}
+
 	// selection
 	drawSelection(painter, option);
 
@@ -296,24 +330,19 @@ void CPolyEdge::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 		painter->drawEllipse(p, r, r);
 
 	// arrows
-	if (m_itemFlags & CF_Start_Arrow)
-	{
-		QLineF arrowLine(m_polyPoints.first(), line().p1());
-		if (arrowLine.length() > ARROW_SIZE * 2)
-			drawArrow(painter, option, true, arrowLine);
-	}
-
-	if (m_itemFlags & CF_End_Arrow)
-	{
-		QLineF arrowLine(m_polyPoints.last(), line().p2());
-		if (arrowLine.length() > ARROW_SIZE * 2)
-			drawArrow(painter, option, true, arrowLine);
-	}
+	drawArrows(painter);
 }
 
 
 // callbacks 
 
+bool CPolyEdge::canPrepareGeometry() const
+{
+	// only the straight line is computed by the base
+	return m_polyPoints.isEmpty() && Super::canPrepareGeometry();
+}
+
+
 void CPolyEdge::onParentGeometryChanged()
 {
 	// straight line
@@ -349,6 +378,7 @@ void CPolyEdge::onParentGeometryChanged()
 
 	QLineF l(p1, p2);
 	setLine(l);
+	notifyGeometryChanged();
 
 	// shift line by arrows
 	double arrowSize = getVisibleWeight() + ARROW_SIZE;
@@ -383,9 +413,13 @@ void CPolyEdge::onParentGeometryChanged()
 
 	m_controlPoint = m_shapeCachePath.pointAtPercent(0.5);
 
-	QPainterPathStroker stroker;
-	stroker.setWidth(6);
-	m_selectionShapePath = stroker.createStroke(m_shapeCachePath);
+	invalidateSelectionShape();
+
+	QLineF startArrow(m_polyPoints.first(), line().p1());
+	QLineF endArrow(m_polyPoints.last(), line().p2());
+	setArrowDirections(
+		startArrow.length() > ARROW_SIZE * 2 ? startArrow : QLineF(),
+		endArrow.length() > ARROW_SIZE * 2 ? endArrow : QLineF());
 
 	update();
 
@@ -426,6 +460,8 @@ void CPolyEdge::createControlPoints()
 
 void CPolyEdge::updateShapeFromPoints()
 {
+	auto oldPoints = m_polyPoints;
+
 	m_polyPoints.clear();
 
 	for (auto cp : m_controlPoints)
@@ -433,5 +469,20 @@ void CPolyEdge::updateShapeFromPoints()
 		m_polyPoints.append(cp->scenePos());
 	}
 
+	notifyPointsChanged(oldPoints, m_polyPoints);
+
 	onParentGeometryChanged();
 }
+
+
+void CPolyEdge::notifyPointsChanged(const QList<QPointF>& oldPoints, const QList<QPointF>& newPoints)
+{
+	if (oldPoints == newPoints)
+		return;
+
+	if (auto tracker = getChangeTracker())
+	{
+		tracker->onItemAttributeChanged(this, "points", 
+			CUtils::pointsToString(oldPoints), CUtils::pointsToString(newPoints));
+	}
+}
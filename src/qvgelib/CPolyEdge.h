@@ -62,6 +62,9 @@ public:
 	virtual void onItemMoved(const QPointF& delta);
 	virtual void onItemSelected(bool state);
 
+	// geometry scheduling
+	virtual bool canPrepareGeometry() const;
+
 protected:
 	// reimp
 	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = Q_NULLPTR);
@@ -73,6 +76,7 @@ private:
 	void dropControlPoints();
 	void createControlPoints();
 	void updateShapeFromPoints();
+	void notifyPointsChanged(const QList<QPointF>& oldPoints, const QList<QPointF>& newPoints);
 
 private:
 	// data model
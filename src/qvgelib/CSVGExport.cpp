@@ -10,7 +10,6 @@ It can be used freely, maintaining the information above.
 #include <QSvgGenerator>
 #include <QPainter>
 #include <QApplication>
-#include <QScopedPointer>
 
 #include "CSVGExport.h"
 #include "CEditorScene.h"
@@ -18,10 +17,10 @@ It can be used freely, maintaining the information above.
 
 bool CSVGExport::save(const QString& fileName, CEditorScene& scene, QString* /*lastError*/) const
 {
-	QScopedPointer<CEditorScene> tempScene(scene.clone());
+	CEditorScene::RenderOptions options;
+	options.cropToContent = m_cutContent;
 
-	if (m_cutContent)
-		tempScene->crop();
+	QRectF sourceRect = scene.getRenderRect(options);
 
 	QSvgGenerator svgWriter;
 	svgWriter.setFileName(fileName);
@@ -38,7 +37,7 @@ bool CSVGExport::save(const QString& fileName, CEditorScene& scene, QString* /*l
 	{
 		int res = svgWriter.resolution();
 		double coeff = m_resolution / (double)res;
-		auto size = tempScene->sceneRect().size();
+		auto size = sourceRect.size();
 		auto sizeInch = size * coeff;
 		//auto sizeMM = sizeInch * 25.4;
 		//svgWriter.setSize(sizeMM.toSize());
@@ -46,13 +45,13 @@ bool CSVGExport::save(const QString& fileName, CEditorScene& scene, QString* /*l
 		svgWriter.setSize(sizeInch.toSize());
 	}
 	else
-		svgWriter.setSize(tempScene->sceneRect().size().toSize());
+		svgWriter.setSize(sourceRect.size().toSize());
 
 	// export
 	QPainter painter(&svgWriter);
 	painter.setRenderHint(QPainter::Antialiasing);
 	painter.setRenderHint(QPainter::TextAntialiasing);
-	tempScene->render(&painter);
+	scene.renderScene(&painter, QRectF(), options);
 	painter.end();
 
 	return true;
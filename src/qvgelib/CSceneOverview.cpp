@@ -0,0 +1,219 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include "CSceneOverview.h"
+#include "CEditorScene.h"
+#include "CNode.h"
+#include "CEdge.h"
+#include "CPolyEdge.h"
+
+#include <QPainter>
+
+
+// beyond this the region unions get slow, the bounding rect is enough
+static const int DIRTY_RECTS_MAX = 64;
+
+
+CSceneOverview::CSceneOverview(CEditorScene &scene, QObject *parent):
+	QObject(parent),
+	m_scene(scene)
+{
+	connect(&m_scene, &QGraphicsScene::sceneRectChanged, this, &CSceneOverview::onSceneRectChanged);
+}
+
+
+void CSceneOverview::setTracking(bool on)
+{
+	if (m_tracking == on)
+		return;
+
+	m_tracking = on;
+
+	if (m_tracking)
+	{
+		connect(&m_scene, &QGraphicsScene::changed, this, &CSceneOverview::onSceneChanged);
+		invalidate();
+	}
+	else
+		disconnect(&m_scene, &QGraphicsScene::changed, this, &CSceneOverview::onSceneChanged);
+}
+
+
+void CSceneOverview::setImageSize(const QSize& size)
+{
+	if (size == m_image.size())
+		return;
+
+	m_image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+
+	updateTransform();
+	invalidate();
+}
+
+
+void CSceneOverview::invalidate()
+{
+	m_dirtyRegion = QRegion(m_image.rect());
+}
+
+
+const QImage& CSceneOverview::getImage()
+{
+	if (m_image.isNull() || m_dirtyRegion.isEmpty())
+		return m_image;
+
+	QRegion dirtyRegion;
+	dirtyRegion.swap(m_dirtyRegion);
+	dirtyRegion &= m_image.rect();
+
+	// the items are collected once (O(N) without the scene index), the rects take their part
+	QRectF sceneRect = m_transform.inverted().mapRect(QRectF(dirtyRegion.boundingRect()));
+	auto sceneItems = m_scene.items(sceneRect, Qt::IntersectsItemBoundingRect, Qt::AscendingOrder);
+
+	// too fragmented: one pass over the bounding rect is cheaper
+	if (dirtyRegion.rectCount() > 16)
+	{
+		renderRegion(dirtyRegion.boundingRect(), sceneItems);
+	}
+	else
+	{
+		for (const QRect& r : dirtyRegion)
+			renderRegion(r, sceneItems);
+	}
+
+	return m_image;
+}
+
+
+// privates
+
+void CSceneOverview::onSceneChanged(const QList<QRectF>& rects)
+{
+	if (m_image.isNull())
+		return;
+
+	for (const QRectF& r : rects)
+	{
+		// 1px more for the antialiased glyphs
+		m_dirtyRegion += m_transform.mapRect(r).toAlignedRect().adjusted(-1, -1, 1, 1);
+
+		if (m_dirtyRegion.rectCount() > DIRTY_RECTS_MAX)
+			m_dirtyRegion = QRegion(m_dirtyRegion.boundingRect());
+	}
+}
+
+
+void CSceneOverview::onSceneRectChanged()
+{
+	updateTransform();
+	invalidate();
+}
+
+
+void CSceneOverview::updateTransform()
+{
+	m_transform.reset();
+
+	QRectF sceneRect = m_scene.sceneRect();
+	if (m_image.isNull() || sceneRect.isEmpty())
+		return;
+
+	// keep aspect ratio & center
+	qreal scale = qMin(m_image.width() / sceneRect.width(), m_image.height() / sceneRect.height());
+	qreal dx = (m_image.width() - sceneRect.width() * scale) / 2;
+	qreal dy = (m_image.height() - sceneRect.height() * scale) / 2;
+
+	m_transform.translate(dx, dy);
+	m_transform.scale(scale, scale);
+	m_transform.translate(-sceneRect.left(), -sceneRect.top());
+}
+
+
+void CSceneOverview::renderRegion(const QRect& imageRect, const QList<QGraphicsItem*>& sceneItems)
+{
+	QPainter painter(&m_image);
+	painter.setClipRect(imageRect);
+
+	QBrush background = m_scene.backgroundBrush();
+	if (background.style() == Qt::NoBrush)
+		background = Qt::white;
+
+	painter.fillRect(imageRect, background);
+
+	painter.setTransform(m_transform);
+
+	QRectF sceneRect = m_transform.inverted().mapRect(QRectF(imageRect));
+
+	QList<CNode*> nodes;
+
+	// edges first: lines between the node centers
+	painter.setRenderHint(QPainter::Antialiasing, false);
+	painter.setBrush(Qt::NoBrush);
+
+	for (auto item : sceneItems)
+	{
+		if (!item->sceneBoundingRect().intersects(sceneRect))
+			continue;
+
+		if (auto node = dynamic_cast<CNode*>(item))
+		{
+			nodes << node;
+			continue;
+		}
+
+		auto edge = dynamic_cast<CEdge*>(item);
+		if (!edge || !edge->isVisible() || !edge->firstNode() || !edge->lastNode())
+			continue;
+
+		// cosmetic pen: 1px at any scale
+		painter.setPen(QPen(edge->getStyle().pen.color(), 0));
+
+		if (auto polyEdge = dynamic_cast<CPolyEdge*>(edge))
+		{
+			if (polyEdge->getPoints().size())
+			{
+				QPolygonF polyline;
+				polyline << edge->firstNode()->pos();
+				for (const auto& p : polyEdge->getPoints())
+					polyline << p;
+				polyline << edge->lastNode()->pos();
+
+				painter.drawPolyline(polyline);
+				continue;
+			}
+		}
+
+		painter.drawLine(edge->firstNode()->pos(), edge->lastNode()->pos());
+	}
+
+	// nodes: a filled ellipse or just a rect when it is too small
+	painter.setRenderHint(QPainter::Antialiasing, true);
+
+	qreal scale = m_transform.m11();
+
+	for (auto node : nodes)
+	{
+		if (!node->isVisible())
+			continue;
+
+		const CItemStyle& style = node->getStyle();
+		QRectF r = node->rect().translated(node->pos());
+
+		if (r.width() * scale < 3 || r.height() * scale < 3)
+		{
+			painter.fillRect(r, style.brush.style() == Qt::NoBrush ? QBrush(style.pen.color()) : style.brush);
+		}
+		else
+		{
+			painter.setPen(QPen(style.pen.color(), 0));
+			painter.setBrush(style.brush);
+			painter.drawEllipse(r);
+		}
+	}
+}
@@ -0,0 +1,60 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QImage>
+#include <QRegion>
+#include <QTransform>
+
+class CEditorScene;
+
+
+// Low-resolution overview of a scene (i.e. for the navigator).
+// The image is cached and only the regions reported by QGraphicsScene::changed() are redrawn.
+// The scene changes are tracked while the overview is shown only: any connection to changed()
+// switches off the direct item updates of all the views.
+// Nodes & edges are drawn as simplified glyphs, other items are skipped.
+
+class CSceneOverview: public QObject
+{
+	Q_OBJECT
+
+public:
+	CSceneOverview(CEditorScene &scene, QObject *parent = nullptr);
+
+	void setImageSize(const QSize& size);
+	QSize getImageSize() const { return m_image.size(); }
+
+	// redraws the changed regions if any
+	const QImage& getImage();
+
+	// drops the cached image
+	void invalidate();
+
+	// switching on invalidates the image: the changes have been missed meanwhile
+	void setTracking(bool on);
+	bool isTracking() const		{ return m_tracking; }
+
+private Q_SLOTS:
+	void onSceneChanged(const QList<QRectF>& rects);
+	void onSceneRectChanged();
+
+private:
+	void updateTransform();
+	void renderRegion(const QRect& imageRect, const QList<QGraphicsItem*>& sceneItems);
+
+	CEditorScene &m_scene;
+
+	QImage m_image;
+	QTransform m_transform;
+	QRegion m_dirtyRegion;
+	bool m_tracking = false;
+};
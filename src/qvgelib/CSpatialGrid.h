@@ -0,0 +1,157 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <QtCore/QList>
+#include <QtCore/QRectF>
+#include <QtCore/QtMath>
+
+
+// Uniform grid of rectangles keyed by T.
+// Lookups only visit the cells covered by the query rectangle.
+
+template<class T>
+class CSpatialGrid
+{
+public:
+	explicit CSpatialGrid(qreal cellSize = 100) { clear(cellSize); }
+
+	void clear(qreal cellSize)
+	{
+		m_cellSize = qMax(cellSize, qreal(1));
+		m_cells.clear();
+		m_rects.clear();
+	}
+
+	void clear() { clear(m_cellSize); }
+
+	qreal cellSize() const	{ return m_cellSize; }
+	int size() const		{ return m_rects.size(); }
+	bool isEmpty() const	{ return m_rects.isEmpty(); }
+
+	bool contains(const T& id) const	{ return m_rects.contains(id); }
+	QRectF rect(const T& id) const		{ return m_rects.value(id); }
+
+	void insert(const T& id, const QRectF& r)
+	{
+		remove(id);
+
+		m_rects[id] = r;
+
+		int x1, y1, x2, y2;
+		cellRange(r, x1, y1, x2, y2);
+		for (int x = x1; x <= x2; ++x)
+			for (int y = y1; y <= y2; ++y)
+				m_cells[cellKey(x, y)].append(id);
+	}
+
+	bool remove(const T& id)
+	{
+		auto it = m_rects.find(id);
+		if (it == m_rects.end())
+			return false;
+
+		int x1, y1, x2, y2;
+		cellRange(*it, x1, y1, x2, y2);
+		for (int x = x1; x <= x2; ++x)
+		{
+			for (int y = y1; y <= y2; ++y)
+			{
+				auto cellIt = m_cells.find(cellKey(x, y));
+				if (cellIt == m_cells.end())
+					continue;
+
+				int index = cellIt->indexOf(id);
+				if (index >= 0)
+				{
+					// order inside of a cell does not matter
+					(*cellIt)[index] = cellIt->last();
+					cellIt->removeLast();
+				}
+
+				if (cellIt->isEmpty())
+					m_cells.erase(cellIt);
+			}
+		}
+
+		m_rects.erase(it);
+		return true;
+	}
+
+	// returns true if any stored rectangle intersects r
+	bool intersects(const QRectF& r) const
+	{
+		int x1, y1, x2, y2;
+		cellRange(r, x1, y1, x2, y2);
+		for (int x = x1; x <= x2; ++x)
+		{
+			for (int y = y1; y <= y2; ++y)
+			{
+				auto cellIt = m_cells.constFind(cellKey(x, y));
+				if (cellIt == m_cells.constEnd())
+					continue;
+
+				for (const T& id : *cellIt)
+				{
+					if (m_rects[id].intersects(r))
+						return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	// returns ids of the rectangles intersecting r
+	QList<T> query(const QRectF& r) const
+	{
+		QList<T> result;
+
+		int x1, y1, x2, y2;
+		cellRange(r, x1, y1, x2, y2);
+		for (int x = x1; x <= x2; ++x)
+		{
+			for (int y = y1; y <= y2; ++y)
+			{
+				auto cellIt = m_cells.constFind(cellKey(x, y));
+				if (cellIt == m_cells.constEnd())
+					continue;
+
+				for (const T& id : *cellIt)
+				{
+					if (m_rects[id].intersects(r) && !result.contains(id))
+						result.append(id);
+				}
+			}
+		}
+
+		return result;
+	}
+
+private:
+	static quint64 cellKey(int x, int y)
+	{
+		return (quint64(quint32(x)) << 32) | quint32(y);
+	}
+
+	void cellRange(const QRectF& r, int& x1, int& y1, int& x2, int& y2) const
+	{
+		x1 = qFloor(r.left() / m_cellSize);
+		y1 = qFloor(r.top() / m_cellSize);
+		x2 = qFloor(r.right() / m_cellSize);
+		y2 = qFloor(r.bottom() / m_cellSize);
+	}
+
+	qreal m_cellSize = 100;
+	QHash<quint64, QVector<T>> m_cells;
+	QHash<T, QRectF> m_rects;
+};
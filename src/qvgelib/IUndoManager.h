@@ -9,10 +9,21 @@ It can be used freely, maintaining the information above.
 
 #pragma once
 
+#include <QtCore/QByteArray>
+#include <QtCore/QVariant>
+#include <QtCore/QPointF>
+
+class CItem;
+class CNode;
+class CEdge;
+struct CAttribute;
+
 
 class IUndoManager
 {
 public:
+	virtual ~IUndoManager() {}
+
 	virtual void reset() = 0;
 	virtual void addState() = 0;
 	virtual void revertState() = 0;
@@ -20,4 +31,15 @@ public:
 	virtual void redo() = 0;
 	virtual int availableUndoCount() const = 0;
 	virtual int availableRedoCount() const = 0;
+
+	// fine-grained change notifications (only used by the managers recording commands)
+	virtual bool isTrackingChanges() const { return false; }
+
+	virtual void onItemAdded(CItem* /*item*/) {}
+	virtual void onItemRemoved(CItem* /*item*/) {}
+	virtual void onItemAttributeChanged(CItem* /*item*/, const QByteArray& /*attrId*/, const QVariant& /*oldValue*/, const QVariant& /*newValue*/) {}
+	virtual void onItemMoved(CItem* /*item*/, const QPointF& /*oldPos*/, const QPointF& /*newPos*/) {}
+	virtual void onEdgeRelinked(CEdge* /*edge*/, CNode* /*oldFirst*/, const QByteArray& /*oldFirstPort*/, CNode* /*oldLast*/, const QByteArray& /*oldLastPort*/) {}
+	virtual void onNodePortsChanged(CNode* /*node*/) {}
+	virtual void onClassAttributeChanged(const QByteArray& /*classId*/, const QByteArray& /*attrId*/, const CAttribute* /*oldAttr*/, const CAttribute* /*newAttr*/) {}
 };
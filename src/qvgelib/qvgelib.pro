@@ -1,5 +1,5 @@
 TARGET = qvgelib
-QT += core gui widgets printsupport xml
+QT += core gui widgets printsupport xml concurrent
 
 include($$PWD/../lib.pri)
 
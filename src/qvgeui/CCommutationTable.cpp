@@ -8,6 +8,7 @@ It can be used freely, maintaining the information above.
 */
 
 #include "CCommutationTable.h"
+#include "CCommutationTableModel.h"
 
 #include <qvgelib/CNodeEditorScene.h>
 #include <qvgelib/CEdge.h>
@@ -20,34 +21,6 @@ It can be used freely, maintaining the information above.
 #include <QMessageBox>
 
 
-// NumSortItem: numeric sorting by ids
-
-class NumSortItem : public QTreeWidgetItem
-{
-public:
-	bool operator < (const QTreeWidgetItem &other) const
-	{
-		int col = treeWidget()->sortColumn();
-		bool b1, b2;
-		int i1 = text(col).toInt(&b1);
-		int i2 = other.text(col).toInt(&b2);
-		if (b1 && b2)
-			return i1 < i2;
-
-		return QTreeWidgetItem::operator < (other);
-	}
-};
-
-
-// fixed section Ids
-
-enum FixedSectionIds 
-{
-	StartNodeId, EndNodeId, EdgeId,
-	CustomId
-};
-
-
 // CCommutationTable
 
 CCommutationTable::CCommutationTable(QWidget *parent)
@@ -56,7 +29,11 @@ CCommutationTable::CCommutationTable(QWidget *parent)
 {
 	ui.setupUi(this);
 
-	ui.Table->header()->setSortIndicator(2, Qt::AscendingOrder);
+	m_model = new CCommutationTableModel(this);
+	ui.Table->setModel(m_model);
+	ui.Table->sortByColumn(CCommutationTableModel::EdgeColumn, Qt::AscendingOrder);
+
+	connect(ui.Table->selectionModel(), &QItemSelectionModel::selectionChanged, this, &CCommutationTable::onTableSelectionChanged);
 
 	ui.Table->setContextMenuPolicy(Qt::CustomContextMenu);
 	connect(ui.Table, SIGNAL(customContextMenuRequested(const QPoint &)), this, SLOT(onCustomContextMenu(const QPoint &)));
@@ -76,8 +53,7 @@ void CCommutationTable::doReadSettings(QSettings& settings)
 	QByteArray extraSections = settings.value("userColumns").toByteArray();
 	if (!extraSections.isEmpty())
 	{
-		m_extraSectionIds = extraSections.split(';');
-		onSceneChanged();
+		m_model->setExtraColumns(extraSections.split(';'));
 	}
 
 	auto *header = ui.Table->header();
@@ -93,14 +69,12 @@ void CCommutationTable::doWriteSettings(QSettings& settings)
 {
 	auto *header = ui.Table->header();
 	settings.setValue("headerState", header->saveState());
-	settings.setValue("userColumns", m_extraSectionIds.join(';'));
+	settings.setValue("userColumns", m_model->getExtraColumns().join(';'));
 }
 
 
 void CCommutationTable::setScene(CNodeEditorScene* scene)
 {
-	ui.Table->clear();
-
 	if (m_scene)
 		onSceneDetached(m_scene);
 
@@ -108,6 +82,8 @@ void CCommutationTable::setScene(CNodeEditorScene* scene)
 
 	setEnabled(m_scene);
 
+	m_model->setScene(m_scene);
+
 	if (m_scene)
 		onSceneAttached(m_scene);
 }
@@ -136,56 +112,12 @@ void CCommutationTable::onSceneDetached(CEditorScene* scene)
 
 void CCommutationTable::onSceneChanged()
 {
-	ui.Table->setUpdatesEnabled(false);
-	ui.Table->blockSignals(true);
-
-	ui.Table->clear();
-	m_edgeItemMap.clear();
-
-	ui.Table->setColumnCount(m_extraSectionIds.size() + CustomId);
-
-	int extraSectionIndex = CustomId;
-	for (const auto& paramId : m_extraSectionIds)
-	{
-		ui.Table->headerItem()->setText(extraSectionIndex++, paramId);
-	}
-
-	QList<CEdge*> edges = m_scene->getItems<CEdge>();
-	for (auto edge : edges)
-	{
-		auto item = new NumSortItem();
-		ui.Table->addTopLevelItem(item);
-
-		m_edgeItemMap[edge] = item;
-
-		if (edge->firstNode())
-		{
-			if (edge->firstPortId().size())
-				item->setText(StartNodeId, edge->firstNode()->getId() + ":" + edge->firstPortId());
-			else
-				item->setText(StartNodeId, edge->firstNode()->getId());
-		}
-		
-		if (edge->lastNode())
-		{
-			if (edge->lastPortId().size())
-				item->setText(EndNodeId, edge->lastNode()->getId() + ":" + edge->lastPortId());
-			else
-				item->setText(EndNodeId, edge->lastNode()->getId());
-		}
-
-		item->setText(EdgeId, edge->getId());
+	//QElapsedTimer tm;
+	//tm.start();
 
-		int extraSectionIndex = CustomId;
-		for (const auto& paramId : m_extraSectionIds)
-		{
-			QString val = edge->getAttribute(paramId).toString();
-			item->setText(extraSectionIndex++, val);
-		}
-	}
+	m_model->sync();
 
-	ui.Table->setUpdatesEnabled(true);
-	ui.Table->blockSignals(false);
+	//qDebug() << "CCommutationTable::onSceneChanged(): " << tm.elapsed();
 
 	// update active selections if any
 	onSelectionChanged();
@@ -194,113 +126,89 @@ void CCommutationTable::onSceneChanged()
 
 void CCommutationTable::onSelectionChanged()
 {
+	if (!m_scene)
+		return;
+
 	ui.Table->setUpdatesEnabled(false);
-	ui.Table->blockSignals(true);
+	ui.Table->selectionModel()->blockSignals(true);
 
 	ui.Table->clearSelection();
 
-	QTreeWidgetItem* scrollItem = NULL;
-
-    QList<CEdge*> edges = m_scene->getSelectedEdges();
-
-	//QElapsedTimer tm;
-	//tm.start();
+	int scrollRow = -1;
+	int lastColumn = m_model->columnCount() - 1;
 
 	QItemSelection selection;
 
-	for (auto edge : edges)
+	for (auto edge : m_scene->getSelectedEdges())
 	{
-		if (m_edgeItemMap.contains(edge))
-		{
-			auto item = m_edgeItemMap[edge];
-			scrollItem = item;
+		int row = m_model->rowOf(edge);
+		if (row < 0)
+			continue;
 
-			//item->setSelected(true);
-			// version with QModelIndex is many ways faster...
-			int row = ui.Table->indexOfTopLevelItem(item);
+		scrollRow = row;
 
-			QModelIndex leftIndex = ui.Table->model()->index(row, 0);
-			QModelIndex rightIndex = ui.Table->model()->index(row, ui.Table->columnCount() - 1);
-
-			QItemSelection rowSelection(leftIndex, rightIndex);
-			selection.append(rowSelection);
-			//selection.merge(rowSelection, QItemSelectionModel::Select);	// slow
-		}
+		selection.append(QItemSelectionRange(m_model->index(row, 0), m_model->index(row, lastColumn)));
 	}
 
 	ui.Table->selectionModel()->select(selection, QItemSelectionModel::Select);
 
-	//qDebug() << "CCommutationTable::onSelectionChanged(): " << tm.elapsed();
+	ui.Table->selectionModel()->blockSignals(false);
+	ui.Table->setUpdatesEnabled(true);
 
-	if (scrollItem)
-		ui.Table->scrollToItem(scrollItem);
+	// repaint: the view missed the selection signals
+	ui.Table->viewport()->update();
 
-	ui.Table->setUpdatesEnabled(true);
-	ui.Table->blockSignals(false);
+	if (scrollRow >= 0)
+		ui.Table->scrollTo(m_model->index(scrollRow, 0));
 }
 
 
-void CCommutationTable::on_Table_itemSelectionChanged()
+void CCommutationTable::onTableSelectionChanged()
 {
 	if (!m_scene)
 		return;
 
-	ui.Table->blockSignals(true);
-
 	m_scene->beginSelection();
 
 	m_scene->deselectAll();
 
-	auto selTableItems = ui.Table->selectedItems();
-	QSet<QString> selIds;
-	for (auto item : selTableItems)
-	{
-		selIds.insert(item->text(2));
-	}
-
-	QList<CEdge*> edges = m_scene->getItems<CEdge>();
-	for (auto edge : edges)
+	for (const auto& index : ui.Table->selectionModel()->selectedRows())
 	{
-		if (selIds.contains(edge->getId()))
+		if (auto edge = m_model->edgeAt(index.row()))
 		{
 			edge->setSelected(true);
 			edge->ensureVisible();
 		}
 	}
 
-	ui.Table->blockSignals(false);
-
 	m_scene->endSelection();
 }
 
 
-void CCommutationTable::on_Table_itemDoubleClicked(QTreeWidgetItem *item, int column)
+void CCommutationTable::on_Table_doubleClicked(const QModelIndex &index)
 {
-	if (!m_scene || !item)
+	CEdge* edge = m_scene ? m_model->edgeAt(index.row()) : nullptr;
+	if (!edge)
 		return;
 
-	if (column < 2)
+	if (index.column() == CCommutationTableModel::StartNodeColumn || index.column() == CCommutationTableModel::EndNodeColumn)
 	{
-		auto nodes = m_scene->getItemsById<CNode>(item->text(column));
-		if (nodes.count())
+		auto node = (index.column() == CCommutationTableModel::StartNodeColumn) ? edge->firstNode() : edge->lastNode();
+		if (node)
 		{
 			m_scene->deselectAll();
-			nodes.first()->setSelected(true);
-			nodes.first()->ensureVisible();
+			node->setSelected(true);
+			node->ensureVisible();
 			return;
 		}
 	}
 
-	if (column == 2)
+	if (index.column() == CCommutationTableModel::EdgeColumn)
 	{
-		auto edges = m_scene->getItemsById<CEdge>(item->text(column));
-		if (edges.count())
-		{
-			m_scene->deselectAll();
-			edges.first()->setSelected(true);
-			edges.first()->ensureVisible();
-			return;
-		}
+		m_scene->deselectAll();
+		edge->setSelected(true);
+		edge->ensureVisible();
+		return;
 	}
 }
 
@@ -310,14 +218,14 @@ void CCommutationTable::onCustomContextMenu(const QPoint& pos)
 	QMenu contextMenu;
 
 	int sectionIndex = ui.Table->header()->logicalIndexAt(pos);
-	if (sectionIndex >= CustomId) 
+	if (sectionIndex >= CCommutationTableModel::CustomColumn) 
 	{
 		QAction* act = contextMenu.addAction(
-			tr("Remove Column [%1]").arg(ui.Table->headerItem()->text(sectionIndex)), 
+			tr("Remove Column [%1]").arg(m_model->headerData(sectionIndex, Qt::Horizontal).toString()), 
 			this, 
 			SLOT(onRemoveSection()));
 
-		act->setData(sectionIndex - CustomId);
+		act->setData(sectionIndex - CCommutationTableModel::CustomColumn);
 
 		contextMenu.addSeparator();
 	}
@@ -337,12 +245,12 @@ void CCommutationTable::on_AddColumnButton_clicked()
 
 void CCommutationTable::on_RestoreButton_clicked()
 {
-	if (!m_extraSectionIds.isEmpty()) {
+	if (!m_model->getExtraColumns().isEmpty()) {
 		int r = QMessageBox::question(NULL, tr("Restore Default Columns"), tr("Are you sure to reset all the custom columns?"));
 		if (r == QMessageBox::Yes)
 		{
-			m_extraSectionIds.clear();
-			onSceneChanged();
+			m_model->setExtraColumns(QByteArrayList());
+			onSelectionChanged();
 		}
 		else
 			return;
@@ -351,16 +259,18 @@ void CCommutationTable::on_RestoreButton_clicked()
 	for (int i = 0; i < ui.Table->header()->count(); ++i)
 		ui.Table->header()->moveSection(ui.Table->header()->visualIndex(i), i);
 
-	ui.Table->header()->setSortIndicator(2, Qt::AscendingOrder);
+	ui.Table->sortByColumn(CCommutationTableModel::EdgeColumn, Qt::AscendingOrder);
 }
 
 
 void CCommutationTable::onAddSection()
 {
+	QByteArrayList extraColumns = m_model->getExtraColumns();
+
 	QByteArrayList paramIdsList = m_scene->getClassAttributes("edge", true).keys();
 	QStringList paramIds;
 	for (const auto& id : paramIdsList)
-		if (!m_extraSectionIds.contains(id))
+		if (!extraColumns.contains(id))
 			paramIds << id;
 
 	QInputDialog dialog;
@@ -374,7 +284,7 @@ void CCommutationTable::onAddSection()
 		return;
 
 	QByteArray paramId = dialog.textValue().toLocal8Bit();
-	if (paramId.size() && !m_extraSectionIds.contains(paramId))
+	if (paramId.size() && !extraColumns.contains(paramId))
 	{
 		int sectionIndex = ui.Table->header()->count() - 1;
 
@@ -385,11 +295,12 @@ void CCommutationTable::onAddSection()
 			sectionIndex = ui.Table->header()->logicalIndexAt(pos);
 		}
 		
-		int listIndex = sectionIndex - CustomId;
+		int listIndex = sectionIndex - CCommutationTableModel::CustomColumn;
 
-		m_extraSectionIds.insert(listIndex+1, paramId);
+		extraColumns.insert(qBound(0, listIndex + 1, extraColumns.size()), paramId);
+		m_model->setExtraColumns(extraColumns);
 
-		onSceneChanged();
+		onSelectionChanged();
 
 		if (ui.Table->horizontalScrollBar())
 		{
@@ -404,6 +315,10 @@ void CCommutationTable::onRemoveSection()
 {
 	QAction* act = (QAction*)sender();
 	int listIndex = act->data().toInt();
-	m_extraSectionIds.removeAt(listIndex);
-	onSceneChanged();
+
+	QByteArrayList extraColumns = m_model->getExtraColumns();
+	extraColumns.removeAt(listIndex);
+	m_model->setExtraColumns(extraColumns);
+
+	onSelectionChanged();
 }
@@ -19,6 +19,7 @@ class CEditorScene;
 class CNodeEditorScene;
 struct CAttribute;
 class CEdge;
+class CCommutationTableModel;
 
 #include "ui_CCommutationTable.h"
 
@@ -44,8 +45,8 @@ protected:
 protected Q_SLOTS:
 	void onSceneChanged();
 	void onSelectionChanged();
-	void on_Table_itemSelectionChanged();
-	void on_Table_itemDoubleClicked(QTreeWidgetItem *item, int column);
+	void onTableSelectionChanged();
+	void on_Table_doubleClicked(const QModelIndex &index);
 	void onCustomContextMenu(const QPoint &);
 	void onAddSection();
 	void onRemoveSection();
@@ -57,9 +58,7 @@ private:
 
 	CNodeEditorScene *m_scene;
 
-	QMap<CEdge*, QTreeWidgetItem*> m_edgeItemMap;
-	
-	QByteArrayList m_extraSectionIds;
+	CCommutationTableModel *m_model;
 };
 
 #endif // CCommutationTable_H
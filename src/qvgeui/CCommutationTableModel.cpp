@@ -0,0 +1,549 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include "CCommutationTableModel.h"
+
+#include <qvgelib/CNodeEditorScene.h>
+#include <qvgelib/CEdge.h>
+#include <qvgelib/CNode.h>
+
+#include <algorithm>
+
+
+// rows are given to the views by chunks
+static const int s_fetchChunk = 1000;
+
+
+CCommutationTableModel::CCommutationTableModel(QObject *parent): QAbstractTableModel(parent)
+{
+}
+
+
+void CCommutationTableModel::setScene(CNodeEditorScene *scene)
+{
+	if (m_scene)
+		disconnect(m_scene, nullptr, this, nullptr);
+
+	beginResetModel();
+
+	m_scene = scene;
+	m_rows.clear();
+	m_rowIndex.clear();
+	m_sortKeys.clear();
+	m_changedEdges.clear();
+	m_fetchedCount = 0;
+
+	if (m_scene)
+	{
+		m_rows = m_scene->getEdges().items();
+		rebuildIndex(0);
+		m_fetchedCount = qMin(m_rows.size(), s_fetchChunk);
+		m_classAttributesVersion = m_scene->getClassAttributesVersion();
+
+		connect(m_scene, &CEditorScene::itemAttributeChanged, this, &CCommutationTableModel::onItemAttributeChanged);
+		connect(m_scene, &CNodeEditorScene::edgeRelinked, this, &CCommutationTableModel::onEdgeRelinked);
+	}
+
+	endResetModel();
+
+	if (m_sortColumn >= 0)
+		sort(m_sortColumn, m_sortOrder);
+}
+
+
+void CCommutationTableModel::setExtraColumns(const QByteArrayList& attrIds)
+{
+	beginResetModel();
+
+	m_extraColumns = attrIds;
+
+	// the sorted column could be another one now: sorted again by the next sync()
+	m_sortKeys.clear();
+
+	endResetModel();
+}
+
+
+// more changed rows: sorting them all is cheaper than moving one by one
+static const int s_maxPlacedRows = 64;
+
+
+void CCommutationTableModel::sync()
+{
+	if (!m_scene)
+		return;
+
+	const auto& edges = m_scene->getEdges();
+
+	bool sorted = (m_sortColumn >= 0 && m_sortKeys.size() == m_rows.size());
+	if (!sorted)
+		m_sortKeys.clear();
+
+	// removed edges: contiguous ranges from the bottom, so the rows above keep their indices
+	int row = m_rows.size() - 1;
+	int lowestRemoved = m_rows.size();
+
+	while (row >= 0)
+	{
+		if (isAlive(m_rows[row]))
+		{
+			--row;
+			continue;
+		}
+
+		int last = row;
+		while (row > 0 && !isAlive(m_rows[row - 1]))
+			--row;
+
+		if (row < m_fetchedCount)
+		{
+			int lastFetched = qMin(last, m_fetchedCount - 1);
+			beginRemoveRows(QModelIndex(), row, lastFetched);
+			m_rows.remove(row, last - row + 1);
+			m_fetchedCount -= lastFetched - row + 1;
+			endRemoveRows();
+		}
+		else
+			m_rows.remove(row, last - row + 1);
+
+		if (sorted)
+			m_sortKeys.remove(row, last - row + 1);
+
+		lowestRemoved = row;
+		--row;
+	}
+
+	if (lowestRemoved < m_rows.size() || m_rowIndex.size() != m_rows.size())
+	{
+		for (auto it = m_rowIndex.begin(); it != m_rowIndex.end(); )
+		{
+			if (it.value() >= lowestRemoved)
+				it = m_rowIndex.erase(it);
+			else
+				++it;
+		}
+
+		rebuildIndex(lowestRemoved);
+	}
+
+	// changed edges: all of them if a class attribute (shown as default value) has been changed
+	bool allChanged = (m_classAttributesVersion != m_scene->getClassAttributesVersion());
+	m_classAttributesVersion = m_scene->getClassAttributesVersion();
+
+	QVector<CEdge*> changed;
+	if (!allChanged)
+	{
+		for (CEdge *edge : m_changedEdges)
+		{
+			if (m_rowIndex.contains(edge))
+				changed << edge;
+		}
+	}
+
+	m_changedEdges.clear();
+
+	// new edges: the rows hold the alive edges only now, so the same count means no new ones
+	QVector<CEdge*> added;
+	if (m_rows.size() != edges.size())
+	{
+		for (CEdge *edge : edges)
+		{
+			if (!m_rowIndex.contains(edge))
+				added << edge;
+		}
+	}
+
+	// few changes in the sorted rows: each one is put to its place
+	if (sorted && !allChanged && changed.size() + added.size() <= s_maxPlacedRows)
+	{
+		for (CEdge *edge : changed)
+			placeRow(m_rowIndex.value(edge), edge, sortKey(edge));
+
+		for (CEdge *edge : added)
+			placeRow(-1, edge, sortKey(edge));
+
+		notifyRowsChanged(changed);
+		return;
+	}
+
+	appendRows(added);
+
+	// the texts are not stored, so the views just request the visible ones again
+	if (allChanged && m_fetchedCount > 0)
+		Q_EMIT dataChanged(index(0, 0), index(m_fetchedCount - 1, columnCount() - 1), { Qt::DisplayRole });
+	else
+		notifyRowsChanged(changed);
+
+	// new rows & changed values: back in order (nothing happens if it is kept)
+	if (m_sortColumn >= 0 && (allChanged || changed.size() || added.size() || !sorted))
+		sort(m_sortColumn, m_sortOrder);
+}
+
+
+void CCommutationTableModel::appendRows(const QVector<CEdge*>& edges)
+{
+	if (edges.isEmpty())
+		return;
+
+	int oldCount = m_rows.size();
+
+	for (CEdge *edge : edges)
+	{
+		m_rowIndex[edge] = m_rows.size();
+		m_rows.append(edge);
+	}
+
+	// out of order now
+	m_sortKeys.clear();
+
+	// all rows have been fetched: the new ones are visible at once
+	if (m_fetchedCount == oldCount)
+	{
+		int newFetched = qMin(m_rows.size(), qMax(m_fetchedCount, s_fetchChunk));
+		if (newFetched > m_fetchedCount)
+		{
+			beginInsertRows(QModelIndex(), m_fetchedCount, newFetched - 1);
+			m_fetchedCount = newFetched;
+			endInsertRows();
+		}
+	}
+}
+
+
+void CCommutationTableModel::notifyRowsChanged(const QVector<CEdge*>& edges)
+{
+	// one range over the changed rows: the views only request the visible ones again
+	int first = m_fetchedCount, last = -1;
+
+	for (CEdge *edge : edges)
+	{
+		int row = m_rowIndex.value(edge, -1);
+		if (row >= 0 && row < m_fetchedCount)
+		{
+			first = qMin(first, row);
+			last = qMax(last, row);
+		}
+	}
+
+	if (last >= 0)
+		Q_EMIT dataChanged(index(first, 0), index(last, columnCount() - 1), { Qt::DisplayRole });
+}
+
+
+CCommutationTableModel::SortKey CCommutationTableModel::sortKey(const CEdge *edge) const
+{
+	// removed edges have no text
+	SortKey key;
+	key.text = isAlive(edge) ? cellText(edge, m_sortColumn) : QString();
+	key.number = key.text.toInt(&key.isNumber);
+	return key;
+}
+
+
+bool CCommutationTableModel::isBefore(const SortKey& k1, const SortKey& k2) const
+{
+	const SortKey& a = (m_sortOrder == Qt::AscendingOrder) ? k1 : k2;
+	const SortKey& b = (m_sortOrder == Qt::AscendingOrder) ? k2 : k1;
+
+	if (a.isNumber && b.isNumber)
+		return a.number < b.number;
+
+	return a.text < b.text;
+}
+
+
+void CCommutationTableModel::placeRow(int from, CEdge *edge, const SortKey& key)
+{
+	// after the equal ones (as the stable sort keeps them); the own old key does not break the order
+	auto pos = std::upper_bound(m_sortKeys.begin(), m_sortKeys.end(), key,
+		[this](const SortKey& k1, const SortKey& k2) { return isBefore(k1, k2); });
+
+	int to = int(pos - m_sortKeys.begin());
+	if (from >= 0 && to > from)
+		--to;		// index without the row itself
+
+	if (to == from)
+	{
+		m_sortKeys[from] = key;
+		return;
+	}
+
+	// the views know the rows up to m_fetchedCount only
+	bool fromFetched = (from >= 0 && from < m_fetchedCount);
+	int fetchedWithout = m_fetchedCount - (fromFetched ? 1 : 0);
+	int rowsWithout = m_rows.size() - (from >= 0 ? 1 : 0);
+	bool toFetched = (to < fetchedWithout || fetchedWithout == rowsWithout);
+
+	if (fromFetched && toFetched)
+	{
+		beginMoveRows(QModelIndex(), from, from, QModelIndex(), to > from ? to + 1 : to);
+		m_rows.remove(from);
+		m_sortKeys.remove(from);
+		m_rows.insert(to, edge);
+		m_sortKeys.insert(to, key);
+		endMoveRows();
+	}
+	else
+	{
+		if (fromFetched)
+		{
+			beginRemoveRows(QModelIndex(), from, from);
+			m_rows.remove(from);
+			m_sortKeys.remove(from);
+			m_fetchedCount--;
+			endRemoveRows();
+		}
+		else if (from >= 0)
+		{
+			m_rows.remove(from);
+			m_sortKeys.remove(from);
+		}
+
+		if (toFetched)
+		{
+			beginInsertRows(QModelIndex(), to, to);
+			m_rows.insert(to, edge);
+			m_sortKeys.insert(to, key);
+			m_fetchedCount++;
+			endInsertRows();
+		}
+		else
+		{
+			m_rows.insert(to, edge);
+			m_sortKeys.insert(to, key);
+		}
+	}
+
+	// only the rows in between are shifted (all below for a new one)
+	int first = (from >= 0) ? qMin(from, to) : to;
+	int last = (from >= 0) ? qMax(from, to) : m_rows.size() - 1;
+
+	for (int i = first; i <= last; ++i)
+		m_rowIndex[m_rows.at(i)] = i;
+}
+
+
+CEdge* CCommutationTableModel::edgeAt(int row) const
+{
+	if (row < 0 || row >= m_fetchedCount)
+		return nullptr;
+
+	CEdge *edge = m_rows.at(row);
+	return isAlive(edge) ? edge : nullptr;
+}
+
+
+int CCommutationTableModel::rowOf(CEdge *edge)
+{
+	int row = m_rowIndex.value(edge, -1);
+
+	if (row >= m_fetchedCount)
+	{
+		beginInsertRows(QModelIndex(), m_fetchedCount, row);
+		m_fetchedCount = row + 1;
+		endInsertRows();
+	}
+
+	return row;
+}
+
+
+bool CCommutationTableModel::isAlive(const CEdge *edge) const
+{
+	// the rows are synced later than the scene changes (or never, if the signals were blocked):
+	// an edge pointer is only dereferenced while the scene still knows it
+	return m_scene && m_scene->getEdges().contains(static_cast<const CItem*>(edge));
+}
+
+
+void CCommutationTableModel::rebuildIndex(int fromRow)
+{
+	m_rowIndex.reserve(m_rows.size());
+
+	for (int i = fromRow; i < m_rows.size(); ++i)
+		m_rowIndex[m_rows.at(i)] = i;
+}
+
+
+QString CCommutationTableModel::cellText(const CEdge *edge, int column) const
+{
+	switch (column)
+	{
+	case StartNodeColumn:
+		if (!edge->firstNode())
+			return QString();
+		if (edge->firstPortId().size())
+			return edge->firstNode()->getId() + ":" + edge->firstPortId();
+		return edge->firstNode()->getId();
+
+	case EndNodeColumn:
+		if (!edge->lastNode())
+			return QString();
+		if (edge->lastPortId().size())
+			return edge->lastNode()->getId() + ":" + edge->lastPortId();
+		return edge->lastNode()->getId();
+
+	case EdgeColumn:
+		return edge->getId();
+
+	default:
+		return edge->getAttribute(m_extraColumns.value(column - CustomColumn)).toString();
+	}
+}
+
+
+// reimp
+
+int CCommutationTableModel::rowCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : m_fetchedCount;
+}
+
+
+int CCommutationTableModel::columnCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : CustomColumn + m_extraColumns.size();
+}
+
+
+QVariant CCommutationTableModel::data(const QModelIndex &index, int role) const
+{
+	if (role != Qt::DisplayRole || !index.isValid())
+		return QVariant();
+
+	const CEdge *edge = edgeAt(index.row());
+	if (!edge)
+		return QVariant();
+
+	return cellText(edge, index.column());
+}
+
+
+QVariant CCommutationTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+		return QVariant();
+
+	switch (section)
+	{
+	case StartNodeColumn:	return tr("Start Node");
+	case EndNodeColumn:		return tr("End Node");
+	case EdgeColumn:		return tr("Edge");
+	default:				return QString(m_extraColumns.value(section - CustomColumn));
+	}
+}
+
+
+void CCommutationTableModel::sort(int column, Qt::SortOrder order)
+{
+	m_sortColumn = column;
+	m_sortOrder = order;
+	m_sortKeys.clear();
+
+	if (column < 0 || column >= columnCount())
+		return;
+
+	// keys once per row, kept for the incremental sync()
+	struct SortItem { SortKey key; CEdge* edge; };
+	QVector<SortItem> items;
+	items.reserve(m_rows.size());
+
+	for (CEdge *edge : m_rows)
+		items << SortItem{ sortKey(edge), edge };
+
+	auto inOrder = [this](const SortItem& i1, const SortItem& i2) { return isBefore(i1.key, i2.key); };
+
+	// already in order: no layout change
+	if (std::is_sorted(items.begin(), items.end(), inOrder))
+	{
+		m_sortKeys.reserve(items.size());
+		for (const auto& item : items)
+			m_sortKeys << item.key;
+
+		return;
+	}
+
+	Q_EMIT layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+	auto oldIndexes = persistentIndexList();
+	QVector<CEdge*> oldEdges;
+	for (const auto& index : oldIndexes)
+		oldEdges << m_rows.value(index.row());
+
+	std::stable_sort(items.begin(), items.end(), inOrder);
+
+	m_sortKeys.reserve(items.size());
+	for (int i = 0; i < items.size(); ++i)
+	{
+		m_rows[i] = items[i].edge;
+		m_sortKeys << items[i].key;
+	}
+
+	rebuildIndex(0);
+
+	QModelIndexList newIndexes;
+	for (int i = 0; i < oldIndexes.size(); ++i)
+	{
+		int row = m_rowIndex.value(oldEdges[i], -1);
+		newIndexes << (row >= 0 && row < m_fetchedCount ? index(row, oldIndexes[i].column()) : QModelIndex());
+	}
+
+	changePersistentIndexList(oldIndexes, newIndexes);
+
+	Q_EMIT layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+
+bool CCommutationTableModel::canFetchMore(const QModelIndex &parent) const
+{
+	return !parent.isValid() && m_fetchedCount < m_rows.size();
+}
+
+
+void CCommutationTableModel::fetchMore(const QModelIndex &parent)
+{
+	if (parent.isValid())
+		return;
+
+	int newFetched = qMin(m_rows.size(), m_fetchedCount + s_fetchChunk);
+	if (newFetched <= m_fetchedCount)
+		return;
+
+	beginInsertRows(QModelIndex(), m_fetchedCount, newFetched - 1);
+	m_fetchedCount = newFetched;
+	endInsertRows();
+}
+
+
+// scene changes
+
+void CCommutationTableModel::onItemAttributeChanged(CItem *item, const QByteArray& attrId)
+{
+	if (auto edge = dynamic_cast<CEdge*>(item))
+	{
+		m_changedEdges.insert(edge);
+		return;
+	}
+
+	// node ids are shown in the start & end columns
+	if (attrId == "id")
+	{
+		if (auto node = dynamic_cast<CNode*>(item))
+		{
+			for (CEdge *edge : node->getConnections())
+				m_changedEdges.insert(edge);
+		}
+	}
+}
+
+
+void CCommutationTableModel::onEdgeRelinked(CEdge *edge)
+{
+	m_changedEdges.insert(edge);
+}
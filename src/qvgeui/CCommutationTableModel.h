@@ -0,0 +1,100 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2021 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QByteArrayList>
+
+class CNodeEditorScene;
+class CItem;
+class CEdge;
+
+
+// Edges of the scene as table rows: the texts are built on demand for the visible rows only.
+// sync() brings the rows in line with the scene by fine-grained insert/remove/move/change notifications;
+// only the edges changed since the last sync are looked at (and put to their sorted place).
+
+class CCommutationTableModel : public QAbstractTableModel
+{
+	Q_OBJECT
+
+public:
+	enum FixedColumns
+	{
+		StartNodeColumn, EndNodeColumn, EdgeColumn,
+		CustomColumn
+	};
+
+	CCommutationTableModel(QObject *parent = nullptr);
+
+	void setScene(CNodeEditorScene *scene);
+	void setExtraColumns(const QByteArrayList& attrIds);
+	const QByteArrayList& getExtraColumns() const	{ return m_extraColumns; }
+
+	// updates the rows after the scene has been changed
+	void sync();
+
+	CEdge* edgeAt(int row) const;
+	// -1 if not found; fetches the rows up to the edge if needed
+	int rowOf(CEdge *edge);
+
+	// reimp
+	virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+	virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+	virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+	virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+	virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+protected:
+	virtual bool canFetchMore(const QModelIndex &parent) const;
+	virtual void fetchMore(const QModelIndex &parent);
+
+private Q_SLOTS:
+	void onItemAttributeChanged(CItem *item, const QByteArray& attrId);
+	void onEdgeRelinked(CEdge *edge);
+
+private:
+	// numbers are compared as numbers
+	struct SortKey
+	{
+		QString text;
+		int number = 0;
+		bool isNumber = false;
+	};
+
+	QString cellText(const CEdge *edge, int column) const;
+	bool isAlive(const CEdge *edge) const;
+	void rebuildIndex(int fromRow);
+
+	SortKey sortKey(const CEdge *edge) const;
+	bool isBefore(const SortKey& k1, const SortKey& k2) const;
+	// moves the row (or inserts the edge if from == -1) to its place in the sorted rows
+	void placeRow(int from, CEdge *edge, const SortKey& key);
+	void appendRows(const QVector<CEdge*>& edges);
+	void notifyRowsChanged(const QVector<CEdge*>& edges);
+
+	CNodeEditorScene *m_scene = nullptr;
+
+	QVector<CEdge*> m_rows;			// all the edges, in the display order
+	QHash<CEdge*, int> m_rowIndex;
+	int m_fetchedCount = 0;			// rows known to the views
+
+	QByteArrayList m_extraColumns;
+
+	int m_sortColumn = -1;
+	Qt::SortOrder m_sortOrder = Qt::AscendingOrder;
+	QVector<SortKey> m_sortKeys;	// of m_rows, while they are sorted
+
+	QSet<CEdge*> m_changedEdges;	// since the last sync()
+	quint64 m_classAttributesVersion = 0;
+};
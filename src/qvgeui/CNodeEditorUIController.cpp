@@ -42,6 +42,9 @@ It can be used freely, maintaining the information above.
 #include <qvgelib/CNodeSceneActions.h>
 #include <qvgelib/CEditorSceneDefines.h>
 #include <qvgelib/CEditorView.h>
+#include <qvgelib/CSceneOverview.h>
+#include <qvgelib/CForceDirectedLayout.h>
+#include <qvgelib/CMultilevelLayout.h>
 #include <qvgelib/ISceneItemFactory.h>
 
 #include <QMenuBar>
@@ -55,6 +58,7 @@ It can be used freely, maintaining the information above.
 #include <QPixmapCache>
 #include <QFileDialog>
 #include <QTimer>
+#include <QApplication>
 
 
 CNodeEditorUIController::CNodeEditorUIController(CMainWindow *parent) :
@@ -472,12 +476,31 @@ void CNodeEditorUIController::createViewMenu()
 }
 
 
+void CNodeEditorUIController::createLayoutMenu()
+{
+	// add layout menu
+	QMenu *layoutMenu = new QMenu(tr("&Layout"));
+	m_parent->menuBar()->insertMenu(m_parent->getWindowMenuAction(), layoutMenu);
+
+	QAction *forceLayoutAction = layoutMenu->addAction(tr("Force-Directed Layout"));
+	forceLayoutAction->setStatusTip(tr("Arrange the nodes by the spring forces along the edges"));
+	forceLayoutAction->setToolTip(tr("Force-directed layout"));
+	connect(forceLayoutAction, &QAction::triggered, this, &CNodeEditorUIController::doForceDirectedLayout);
+
+	QAction *multilevelLayoutAction = layoutMenu->addAction(tr("Multilevel Layout (Large Graphs)"));
+	multilevelLayoutAction->setStatusTip(tr("Arrange the nodes level by level from a coarsened graph, fast on the big graphs"));
+	multilevelLayoutAction->setToolTip(tr("Multilevel layout"));
+	connect(multilevelLayoutAction, &QAction::triggered, this, &CNodeEditorUIController::doMultilevelLayout);
+}
+
+
 void CNodeEditorUIController::createMenus()
 {
 	createFileMenu();
 	createEditMenu();
 	createSelectMenu();
 	createViewMenu();
+	createLayoutMenu();
 }
 
 
@@ -543,10 +566,14 @@ void CNodeEditorUIController::createNavigator()
     sliderButton->setIcon(QIcon(":/Icons/Navigator"));
     sliderButton->setToolTip(tr("Show scene navigator"));
     connect(m_sliderView, SIGNAL(aboutToShow()), this, SLOT(onNavigatorShown()));
+	connect(sliderButton->menu(), SIGNAL(aboutToHide()), this, SLOT(onNavigatorHidden()));
 
     m_sliderView->setFixedSize(200,200);
     m_sliderView->setSliderOpacity(0.3);
     m_sliderView->setSliderBrush(Qt::green);
+
+	// cached overview, updated incrementally from the scene changes while the navigator is shown
+	m_sceneOverview = new CSceneOverview(*m_editorScene, this);
 }
 
 
@@ -562,16 +589,17 @@ void CNodeEditorUIController::onNavigatorShown()
     QResizeEvent re(m_sliderView->size(), m_sliderView->parentWidget()->size());
     qApp->sendEvent(m_sliderView->parentWidget(), &re);
 
-    QPixmap pm(m_sliderView->size());
-    QPainter p(&pm);
+	m_sceneOverview->setImageSize(m_sliderView->size());
+	m_sceneOverview->setTracking(true);
 
-	CEditorScene* tempScene = m_editorScene->clone();
-	tempScene->enableGrid(false);
-	tempScene->enableItemLabels(false);
-	tempScene->render(&p);
-	delete tempScene;
+	m_sliderView->setBackgroundBrush(QPixmap::fromImage(m_sceneOverview->getImage()));
+}
 
-	m_sliderView->setBackgroundBrush(pm);
+
+void CNodeEditorUIController::onNavigatorHidden()
+{
+	// no changed() connection when not needed: the views update the items directly then
+	m_sceneOverview->setTracking(false);
 }
 
 
@@ -585,10 +613,10 @@ void CNodeEditorUIController::onSelectionChanged()
 
 void CNodeEditorUIController::onSceneChanged()
 {
-    auto nodes = m_editorScene->getItems<CNode>();
-    auto edges = m_editorScene->getItems<CEdge>();
+    int nodesCount = m_editorScene->getNodes().size();
+    int edgesCount = m_editorScene->getEdges().size();
 
-    m_statusLabel->setText(tr("Nodes: %1 | Edges: %2").arg(nodes.size()).arg(edges.size()));
+    m_statusLabel->setText(tr("Nodes: %1 | Edges: %2").arg(nodesCount).arg(edgesCount));
 
 	updateActions();
 }
@@ -969,6 +997,32 @@ void CNodeEditorUIController::onLayoutFinished()
 }
 
 
+void CNodeEditorUIController::doForceDirectedLayout()
+{
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+
+	CForceDirectedLayout layout;
+	layout.doLayout(*m_editorScene);
+
+	QApplication::restoreOverrideCursor();
+
+	onLayoutFinished();
+}
+
+
+void CNodeEditorUIController::doMultilevelLayout()
+{
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+
+	CMultilevelLayout layout;
+	layout.doLayout(*m_editorScene);
+
+	QApplication::restoreOverrideCursor();
+
+	onLayoutFinished();
+}
+
+
 // zooming
 
 
@@ -66,6 +66,7 @@ private Q_SLOTS:
 	void doBackup();
 
 	void onNavigatorShown();
+	void onNavigatorHidden();
 
 	void onSelectionChanged();
     void onSceneChanged();
@@ -101,6 +102,8 @@ private Q_SLOTS:
 	void find();
 
 	void onLayoutFinished();
+	void doForceDirectedLayout();
+	void doMultilevelLayout();
 
 private:
 	void createMenus();
@@ -108,6 +111,7 @@ private:
 	void createEditMenu();
 	void createSelectMenu();
 	void createViewMenu();
+	void createLayoutMenu();
 
 	void createPanels();
     void createNavigator();
@@ -128,6 +132,7 @@ private:
 	CEditorView *m_editorView = nullptr;
 
     class QSint::Slider2d *m_sliderView = nullptr;
+	class CSceneOverview *m_sceneOverview = nullptr;
 
     QLabel *m_statusLabel = nullptr;
 